@@ -6,10 +6,100 @@
  * @date 2023
 */
 
+#define _GNU_SOURCE
+
 #include "game.h"
+#include <string.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef GAME_ZSTD
+#include <zstd.h>
+#endif
 
 // Players limit
 #define MAX_PLAYERS 35
+// Alignment of the parts of game's memory
+#define ALIGN 64
+// Size of a huge page, blocks of @ref game_new_ex are rounded up to it
+#define HUGE_PAGE ((size_t) 2 << 20)
+// Number of size classes of @ref game_cache
+#define CACHE_CLASSES 16
+// Number of games kept in one size class
+#define CACHE_GAMES 64
+// Number of rows rendered by one task of @ref game_board_parallel
+#define BAND_ROWS 256
+// Number of columns recounted by one task of @ref game_set_boundary's recount
+#define BAND_COLUMNS 64
+// Size of a buffer of @ref game_board_write
+#define WRITE_CHUNK (64 * 1024)
+// Number of buffers of @ref game_board_write written by one writev
+#define WRITE_RING 8
+// Width of the border around the board
+#define BORDER 2
+// Owner of border's fields, never equal to a player or to a free field
+#define SENTINEL UINT32_MAX
+// First of five ids marking the path of @ref walk_area, never given to an area
+#define PATH_ID (UINT32_MAX - 5)
+// Binary logarithm of the number of fields marked by one bit of the dirty bitmap
+#define DIRTY_SHIFT 6
+
+#ifdef GAME_TILED
+// Width and height of a tile
+#define TILE 8
+// Number of fields in a tile
+#define TILE_CELLS (TILE * TILE)
+// Bits of column's number inside the tile's Z-order index
+#define TILE_X 0x15u
+// Bits of row's number inside the tile's Z-order index
+#define TILE_Y 0x2Au
+#endif
+
+#ifdef GAME_STATS
+#include <time.h>
+// Measurements of engine's work, see @ref game_stats
+#define STATS_BEGIN(t) uint64_t t = stats_clock()
+#define STATS_END(g, ph, t) stats_time(&(g)->stats.phase[ph], stats_clock() - (t))
+#define STATS_REJECT(g, reason, t) stats_reject(&(g)->stats, reason, stats_clock() - (t))
+#define STATS_MERGE(g, fields) stats_merge(&(g)->stats, fields)
+#define STATS_BOARD(g, bytes) stats_board((game_stats_t *) &(g)->stats, bytes)
+#else
+#define STATS_BEGIN(t)
+#define STATS_END(g, ph, t)
+#define STATS_REJECT(g, reason, t)
+#define STATS_MERGE(g, fields)
+#define STATS_BOARD(g, bytes)
+#endif
+
+/** @brief Field waiting in @ref label_strip or a neighbour in @ref game_undo
+ * c - index of the field
+ * x, y - coordinates of the field
+*/
+struct pending {
+    size_t c;
+    uint32_t x;
+    uint32_t y;
+};
+typedef struct pending pending_t;
+
+/** @brief Move recorded for @ref game_undo
+ * c - index of the taken field
+ * turn - player to move before the move, restored by @ref game_undo
+*/
+struct undo {
+    size_t c;
+    uint32_t turn;
+};
+typedef struct undo undo_t;
 
 /** @brief Representation of board's square
  * player - number of player on this field
@@ -21,15 +111,32 @@ struct pair {
 };
 typedef struct pair pair_t;
 
+/** @brief Representation of area
+ * info - statistics reported by @ref game_areas
+ * player - owner of the area, zero when the record is unused
+ * prev, next - neighbours on owner's list of areas (next links free records)
+*/
+struct area {
+    game_area_t info;
+    uint32_t player;
+    uint32_t prev;
+    uint32_t next;
+};
+typedef struct area area_t;
+
 /** @brief Representation of player
  * boundary - number of free fields around player's areas
  * busy_areas - number of areas that player used in the game
  * completed_moves - number of pawns that player set on the board
+ * first_area - id of the first area on player's list
+ * blocked - player used all areas and no free field touches them
 */
 struct player {
     uint64_t boundary;
     uint32_t busy_areas;
     uint64_t completed_moves;
+    uint32_t first_area;
+    bool blocked;
 };
 typedef struct player player_t;
 
@@ -38,404 +145,2773 @@ typedef struct player player_t;
  * height - board's height
  * areas - number that limits creating independent areas
  * 
- * board - 2d array of pairs that stores information about the fields
- * neighbours - 4 element array that stores information about <x,y> neighbours
+ * board - array of pairs that stores information about the fields,
+ *         surrounded by BORDER fields of SENTINEL, column after column or,
+ *         with GAME_TILED defined, tile after tile in rows of tiles
+ *         and in Z-order inside a tile
+ * stride - distance between columns (between rows of tiles) in board
+ * cells - number of elements of board
+ * neighbours - ids of player's areas around <x,y>
  * 
  * players - array of players participating in the game
  * players_num - number of players participating in the game
+ * blocked_num - number of blocked players, see @ref update_blocked
+ * turn - player on turn of @ref game_play, blocked players from this one
+ *        are skipped when the turn is asked for
+ *
+ * area_list - array of areas indexed by parent_id, record 0 is unused
+ * area_cap - number of records in area_list, enough for every area
+ *            that can exist at the same time
+ * area_top - first record that was never used
+ * free_area - id of the first released record
+ *
+ * dirty - bitmap of blocks of 2^DIRTY_SHIFT fields of the board where a field
+ *         was taken, only these blocks are cleared by @ref game_reset
+ * taken - number of pawns on the board
+ * undo - ring of the last moves, taken back by @ref game_undo
+ * undo_cap - number of records of the ring
+ * undo_top - record written by the next move
+ * undo_len - number of records that can be taken back, fields set
+ *            by @ref game_import are not among them
+ *
+ * memory - allocation of @ref game_new that holds the whole game,
+ *          NULL when the memory was given to @ref game_new_in
+ * mapped - length of memory mapped by @ref game_new_ex, zero when memory
+ *          comes from calloc
+ *
+ * deferred - moves do not update boundaries and perimeters,
+ *            see @ref game_set_boundary
+ * stale - boundaries and perimeters have to be recounted
+ * recount_pool - threads of the recount, can be NULL
+ *
+ * stats - engine's counters, only with GAME_STATS defined
 */
 struct game {
-    pair_t ** board;
+    pair_t * board;
+    size_t stride;
+    size_t cells;
     player_t * players;
-    uint32_t * neighbours;
+    uint32_t neighbours[4];
 
     uint32_t width;
     uint32_t height;
     uint32_t areas;
     uint32_t players_num;
-};
-typedef struct game game_t;
+    uint32_t blocked_num;
+    uint32_t turn;
 
-game_t * game_new(uint32_t width, uint32_t height,
-                    uint32_t players, uint32_t areas) {
-    if (!width || !height || !players || !areas) { return NULL; }
-    if (players > MAX_PLAYERS) { return NULL; }
+    area_t * area_list;
+    uint32_t area_cap;
+    uint32_t area_top;
+    uint32_t free_area;
 
-    game_t * g = (game_t *) malloc(sizeof(game_t));
-    if (g == NULL) { return NULL; }
+    uint64_t * dirty;
+    uint64_t taken;
 
-    g->width = width;
-    g->height = height;
-    g->areas = areas;
+    undo_t * undo;
+    uint32_t undo_cap;
+    uint32_t undo_top;
+    uint32_t undo_len;
 
-    g->players_num = players;
-    g->players = (player_t *) calloc(g->players_num, sizeof(player_t));
-    if (g->players == NULL) { return NULL; }
-    g->neighbours = (uint32_t *) calloc(4, sizeof(uint32_t));
-    if (g->neighbours == NULL) { return NULL; }
+    void * memory;
+    size_t mapped;
 
-    g->board = (pair_t **) malloc(width * sizeof(pair_t *));
-    if (g->board == NULL) { return NULL; }
+    bool deferred;
+    bool stale;
+    game_pool_t * recount_pool;
 
-    for (size_t i = 0; i < width; i++) {
-        g->board[i] = (pair_t *) calloc(height, sizeof(pair_t));
-        if (g->board[i] == NULL) { return NULL; }
-    }
+#ifdef GAME_STATS
+    game_stats_t stats;
+#endif
+};
+typedef struct game game_t;
 
-    return g;
+#ifdef GAME_STATS
+/** @brief stats_clock.
+ * Reads processor's cycle counter
+ * @return current number of cycles
+*/
+static inline uint64_t stats_clock(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
 }
 
-void game_delete(game_t *g) {
-    if (g == NULL) { return; }
+/** @brief stats_bucket.
+ * Calculates histogram's bucket of value
+ * @param[in] value - measured value
+ * @return floor(log2(value)) limited to the number of buckets
+*/
+static inline uint32_t stats_bucket(uint64_t value) {
+    uint32_t bucket = 0;
+    while (value > 1 && bucket + 1 < GAME_STATS_BUCKETS) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
 
-    for (size_t i = 0; i < g->width; i++) { free(g->board[i]); }
-    free(g->board);
+/** @brief stats_time.
+ * Adds measurement to the timer
+ * @param[in,out] timer - timer of the phase
+ * @param[in] cycles - measured cycles
+*/
+static inline void stats_time(game_stats_timer_t *timer, uint64_t cycles) {
+    timer->count++;
+    timer->cycles += cycles;
+    timer->hist[stats_bucket(cycles)]++;
+}
 
-    free(g->neighbours);
-    free(g->players);
-    free(g);
+/** @brief stats_reject.
+ * Counts rejected move
+ * @param[in,out] stats - engine's counters
+ * @param[in] reason - result of @ref game_move_ex
+ * @param[in] cycles - measured cycles
+*/
+static inline void stats_reject(game_stats_t *stats, uint32_t reason,
+                                uint64_t cycles) {
+    stats->rejected[reason]++;
+    stats_time(&stats->phase[GAME_STATS_REJECT], cycles);
 }
 
-/** @brief valid_coordinate 
- * defines whether the fields exists
- * @param[in] width - board width
- * @param[in] height - board height
- * @param[in] x - column's number
- * @param[in] y - row's number 
- * @return @p true if fields exists and 
- * @p false if coordinates are incorrect
+/** @brief stats_merge.
+ * Counts relabeled fields of merged area
+ * @param[in,out] stats - engine's counters
+ * @param[in] fields - number of relabeled fields
 */
-static bool valid_coordinate(uint32_t width, uint32_t height,
-                                uint32_t x, uint32_t y) {
-    return !(x >= width || y >= height);
+static inline void stats_merge(game_stats_t *stats, uint64_t fields) {
+    stats->merges++;
+    stats->merged_fields += fields;
+    stats->merge_hist[stats_bucket(fields)]++;
 }
 
-/** @brief isSurrounded.
- * Calculates symbol of fields that connects to <x,y> 
- * @param[in] board - representation of game board
- * @param[in] width - board width
- * @param[in] height - board height
- * @param[in] player - player's number
- * @param[in] x - column's number
- * @param[in] y - row's number  
- * @return number of player's fields around <x,y>
+/** @brief stats_board.
+ * Counts rendered board. Boards of one game can be rendered
+ * at the same time, so the counters are changed atomically
+ * @param[in,out] stats - engine's counters
+ * @param[in] bytes - length of the description
 */
-static uint32_t isSurrounded(pair_t ** const board, uint64_t width,
-                    uint64_t height, uint64_t player, uint64_t x, uint64_t y) {
-    uint32_t around = 0;
-    if (x > 0 && valid_coordinate(width, height, x - 1, y)) {
-        if (board[x - 1][y].player == player) { around++; }
-    }
-    if (x + 1 < width && valid_coordinate(width, height, x + 1, y)) {
-        if (board[x + 1][y].player == player) { around++; }
-    }
-    if (y > 0 && valid_coordinate(width, height, x, y - 1)) {
-        if (board[x][y - 1].player == player) { around++; }
-    }
-    if (y + 1 < height && valid_coordinate(width, height, x, y + 1)) {
-        if (board[x][y + 1].player == player) { around++; }
-    }
-    return around;
+static inline void stats_board(game_stats_t *stats, uint64_t bytes) {
+#ifdef __GNUC__
+    __atomic_fetch_add(&stats->boards, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->board_bytes, bytes, __ATOMIC_RELAXED);
+#else
+    stats->boards++;
+    stats->board_bytes += bytes;
+#endif
 }
+#endif
 
-/** @brief common_free_fields.
- * Calculates fields that are in a "1" distance with field <x,y>
- * @param[in] board - representation of game board
- * @param[in] width - board width
- * @param[in] height - board height
- * @param[in] player - player's number
- * @param[in] x - column's number
- * @param[in] y - row's number  
- * @return number of player's fields in a distance
+/** @brief Iterator over fields of the board in the order of storage
+ * c - index of the field
+ * x, y - coordinates of the field including the border,
+ *        the field is on the board if x - BORDER < width
+ *        and y - BORDER < height
 */
-static uint32_t common_free_fields(pair_t ** const board, uint32_t width,
-                    uint32_t height, uint32_t player, uint32_t x, uint32_t y) {
-    uint32_t common = 0;
-    if (x > 1 && valid_coordinate(width, height, x - 2, y)) {
-        if (board[x - 2][y].player == player) { common++; }
-    }
-    if (x + 2 < width && valid_coordinate(width, height, x + 2, y)) {
-        if (board[x + 2][y].player == player) { common++; }
-    }
-    if (y > 1 && valid_coordinate(width, height, x, y - 2)) {
-        if (board[x][y - 2].player == player) { common++; }
-    }
-    if (y + 2 < height && valid_coordinate(width, height, x, y + 2)) {
-        if (board[x][y + 2].player == player) { common++; }
-    }
-    return common;
+struct cell_iter {
+    size_t c;
+    uint32_t x;
+    uint32_t y;
+};
+typedef struct cell_iter cell_iter_t;
+
+#ifndef GAME_TILED
+
+/** @brief layout.
+ * Sets the shape of the column-major board
+ * @param[in,out] g - pointer to game structure with width and height
+*/
+static inline void layout(game_t *g) {
+    g->stride = (size_t) g->height + 2 * BORDER;
+    g->cells = ((size_t) g->width + 2 * BORDER) * g->stride;
 }
 
-/** @brief update_strangers_boundary 
- * decreases player's boundary whether it connects to
- * different player's field
+/** @brief field.
+ * Calculates index of <x,y> in the board
  * @param[in] g - pointer to game structure
- * @param[in] player - player's number
  * @param[in] x - column's number
- * @param[in] y - row's number 
+ * @param[in] y - row's number
+ * @return index of the field
 */
-static void update_strangers_boundary(game_t *g, uint32_t player,
-                                        uint32_t x, uint32_t y) {
-    uint32_t stranger = g->board[x][y].player;
-    if (!stranger) { return; }
-    if (valid_coordinate(g->width, g->height, x, y) && stranger != player) {
-        g->players[stranger - 1].boundary--;
-    }
+static inline size_t field(game_t const *g, uint32_t x, uint32_t y) {
+    return ((size_t) x + BORDER) * g->stride + y + BORDER;
 }
 
-/** @brief update_strangers.
- * Helper to @ref update_strangers_boundary.
+/** @brief Neighbours of the field with index c. */
+static inline size_t left(game_t const *g, size_t c) { return c - g->stride; }
+static inline size_t right(game_t const *g, size_t c) { return c + g->stride; }
+static inline size_t down(game_t const *g, size_t c) { (void) g; return c - 1; }
+static inline size_t up(game_t const *g, size_t c) { (void) g; return c + 1; }
+
+/** @brief position.
+ * Inverse of @ref field
  * @param[in] g - pointer to game structure
- * @param[in] player - player's number
- * @param[in] x - column's number
- * @param[in] y - row's number
+ * @param[in] c - index of the field
+ * @return iterator at the field
 */
-static void update_strangers(game_t *g, uint32_t player, uint32_t x, uint32_t y) {
-    if (x > 0) { update_strangers_boundary(g, player, x - 1, y); }
-    if (x + 1 < g->width) { update_strangers_boundary(g, player, x + 1, y); }
-    if (y > 0) { update_strangers_boundary(g, player, x, y - 1); }
-    if (y + 1 < g->height) { update_strangers_boundary(g, player, x, y + 1); }
+static inline cell_iter_t position(game_t const *g, size_t c) {
+    return (cell_iter_t) { c, (uint32_t) (c / g->stride), (uint32_t) (c % g->stride) };
 }
 
+/** @brief cells_begin.
+ * @param[in] g - pointer to game structure
+ * @return iterator at the first stored field
+*/
+static inline cell_iter_t cells_begin(game_t const *g) {
+    (void) g;
+    return (cell_iter_t) { 0, 0, 0 };
+}
 
-/** @brief diagonal_neighbours.
- * Calculates existing fields on the diagonals of <x,y>
+/** @brief cells_next.
+ * Moves the iterator to the next stored field
  * @param[in] g - pointer to game structure
- * @param[in] player - player's number
- * @param[in] x - column's number
- * @param[in] y - row's number
- * @return non-zero diagonal fields
-*/
-static uint32_t diagonal_neighbours(game_t *g, uint32_t player,
-                                        uint32_t x, uint32_t y) {
-    uint32_t diagonal = 0;
-    if (x > 0) {
-        if (y > 0) {
-            if (g->board[x - 1][y - 1].player == player) {
-                if (g->board[x][y - 1].player == 0) { diagonal++; }
-                if (g->board[x - 1][y].player == 0) { diagonal++; }
-            }
-        }
-    }
-    if (x + 1 < g->width) {
-        if (y + 1 < g->height) {
-            if (g->board[x + 1][y + 1].player == player) {
-                if (g->board[x][y + 1].player == 0) { diagonal++; }
-                if (g->board[x + 1][y].player == 0) { diagonal++; }
-            }
-        }
+ * @param[in,out] it - iterator
+*/
+static inline void cells_next(game_t const *g, cell_iter_t *it) {
+    it->c++;
+    if (++it->y == g->stride) {
+        it->y = 0;
+        it->x++;
     }
-    return diagonal;
 }
 
-/** @brief different_areas.
- * Calcutes how many different areas are in <x,y> surroundings
- * @param[in] neighbours - array of surrounding fields
- * @param[in] around - number of non-zero fields around <x,y>
- * @return different_areas result
+#else
+
+/** @brief dilate.
+ * Spreads bits 0, 1, 2 of @p v to bits 0, 2, 4
+ * @param[in] v - coordinate inside the tile
+ * @return Z-order bits of the coordinate
 */
-static uint32_t different_areas(const uint32_t * neighbours, uint32_t around) {
-    if (around == 4) { return around; }
+static inline size_t dilate(uint32_t v) {
+    return (v & 1u) | ((v & 2u) << 1) | ((v & 4u) << 2);
+}
 
-    uint32_t areas = 0;
-    for (int i = 0; i < 3; i++) {
-        for (int j = i + 1; j < 4 && areas < around; j++) {
-            if (neighbours[i] && neighbours[j] && neighbours[i] != neighbours[j]) {
-                areas++;
-            }
-        }
-    }
-    return areas == 0 ? 1 : areas;
+/** @brief compact.
+ * Inverse of @ref dilate
+ * @param[in] v - Z-order bits of the coordinate
+ * @return coordinate inside the tile
+*/
+static inline uint32_t compact(size_t v) {
+    return (uint32_t) ((v & 1u) | ((v >> 1) & 2u) | ((v >> 2) & 4u));
+}
+
+/** @brief layout.
+ * Sets the shape of the tiled board
+ * @param[in,out] g - pointer to game structure with width and height
+*/
+static inline void layout(game_t *g) {
+    size_t tiles_x = ((size_t) g->width + 2 * BORDER + TILE - 1) / TILE;
+    size_t tiles_y = ((size_t) g->height + 2 * BORDER + TILE - 1) / TILE;
+    g->stride = tiles_x * TILE_CELLS;
+    g->cells = tiles_y * g->stride;
 }
 
-/** @brief BFS (breadth first search).
- * Updates id for united area
+/** @brief field.
+ * Calculates index of <x,y> in the board
  * @param[in] g - pointer to game structure
- * @param[in] id - id of given field
- * @param[in] player - player's number
  * @param[in] x - column's number
  * @param[in] y - row's number
+ * @return index of the field
 */
-static void BFS(game_t* g, uint32_t id, uint32_t player, uint32_t x, uint32_t y) {
-    if (!valid_coordinate(g->width, g->height, x, y)) { return; }
-    if (g->board[x][y].player == player && g->board[x][y].parent_id != id) {
-        g->board[x][y].parent_id = id;
-        BFS(g, id, player, x - 1, y);
-        BFS(g, id, player, x + 1, y);
-        BFS(g, id, player, x, y - 1);
-        BFS(g, id, player, x, y + 1);
-    }
+static inline size_t field(game_t const *g, uint32_t x, uint32_t y) {
+    x += BORDER;
+    y += BORDER;
+    return (y / TILE) * g->stride + (size_t) (x / TILE) * TILE_CELLS
+           + dilate(x % TILE) + (dilate(y % TILE) << 1);
 }
 
-/** @brief set_id.
- * defines new id for united area
- * @param[in] neighbours - array of surrounding fields
- * @return new id
+/** @brief Neighbours of the field with index c.
+ * Column's bits are incremented in place, so the carry moves
+ * to the next tile of the row. Row's bits carry to the next row
+ * of tiles, which is stride fields further.
 */
-static uint32_t set_id(uint32_t * neighbours) {
-    if (neighbours[0]) { return neighbours[0]; }
-    if (neighbours[1]) { return neighbours[1]; }
-    if (neighbours[2]) { return neighbours[2]; }
-    if (neighbours[3]) { return neighbours[3]; }
-    return 0;
+static inline size_t left(game_t const *g, size_t c) {
+    (void) g;
+    return (((c & ~(size_t) TILE_Y) - 1) & ~(size_t) TILE_Y) | (c & TILE_Y);
+}
+static inline size_t right(game_t const *g, size_t c) {
+    (void) g;
+    return (((c | TILE_Y) + 1) & ~(size_t) TILE_Y) | (c & TILE_Y);
+}
+static inline size_t down(game_t const *g, size_t c) {
+    size_t t = ((c & TILE_Y) | TILE_CELLS) - 1;
+    size_t borrow = ((t / TILE_CELLS) & 1u) ^ 1u;
+    return ((c & ~(size_t) (TILE_CELLS - 1)) - borrow * g->stride)
+           | (t & TILE_Y) | (c & TILE_X);
+}
+static inline size_t up(game_t const *g, size_t c) {
+    size_t t = ((c & (TILE_CELLS - 1)) | TILE_X) + 1;
+    size_t carry = t / TILE_CELLS;
+    return ((c & ~(size_t) (TILE_CELLS - 1)) + carry * g->stride)
+           | (t & TILE_Y) | (c & TILE_X);
 }
 
-/** @brief find_neighbours.
- * Search if fields around belongs to same player and writes field id
+/** @brief cells_tile.
+ * Sets coordinates of the field at the beginning of a tile
  * @param[in] g - pointer to game structure
- * @param[in] player - player's number
- * @param[in] x - column's number
- * @param[in] y - row's number
+ * @param[in,out] it - iterator with index of the field
 */
-static void find_neighbours(game_t *g, uint32_t player, uint32_t x, uint32_t y) {
-    g->neighbours[0] = (x > 0 && g->board[x - 1][y].player == player)
-                         ? g->board[x - 1][y].parent_id : 0;
-    g->neighbours[1] = (x + 1 < g->width && g->board[x + 1][y].player == player)
-                         ? g->board[x + 1][y].parent_id : 0;
-    g->neighbours[2] = (y > 0 && g->board[x][y - 1].player == player)
-                         ? g->board[x][y - 1].parent_id : 0;
-    g->neighbours[3] = (y + 1 < g->height && g->board[x][y + 1].player == player)
-                         ? g->board[x][y + 1].parent_id : 0;
+static inline void cells_tile(game_t const *g, cell_iter_t *it) {
+    size_t tiles_x = g->stride / TILE_CELLS;
+    size_t tile = it->c / TILE_CELLS;
+    it->x = (uint32_t) (tile % tiles_x) * TILE;
+    it->y = (uint32_t) (tile / tiles_x) * TILE;
 }
 
-bool game_move(game_t *g, uint32_t player, uint32_t x, uint32_t y) {
-    // game structure correctness
-    if (g == NULL || g->players == NULL || g->players_num < player) { return false; }
-    // coordinates correctness
-    if (!valid_coordinate(g->width, g->height, x, y)) { return false; }
-    // free field
-    if (g->board[x][y].player != 0) { return false; }
+/** @brief cells_begin.
+ * @param[in] g - pointer to game structure
+ * @return iterator at the first stored field
+*/
+static inline cell_iter_t cells_begin(game_t const *g) {
+    (void) g;
+    return (cell_iter_t) { 0, 0, 0 };
+}
 
-    uint32_t around = isSurrounded(g->board, g->width, g->height, player, x, y);
+/** @brief cells_next.
+ * Moves the iterator to the next stored field
+ * @param[in] g - pointer to game structure
+ * @param[in,out] it - iterator
+*/
+static inline void cells_next(game_t const *g, cell_iter_t *it) {
+    size_t in_tile = ++it->c % TILE_CELLS;
+    if (in_tile == 0) {
+        cells_tile(g, it);
+    } else {
+        it->x = (it->x & ~(uint32_t) (TILE - 1)) + compact(in_tile & TILE_X);
+        it->y = (it->y & ~(uint32_t) (TILE - 1)) + compact((in_tile & TILE_Y) >> 1);
+    }
+}
 
-    if (!around) {
-        if (g->players[player - 1].busy_areas == g->areas) {
-            return false;
-        } else {
-            // is an "island"
-            g->board[x][y].player = player;
-            g->players[player - 1].busy_areas++;
-            g->board[x][y].parent_id = g->players[player - 1].busy_areas;
+/** @brief position.
+ * Inverse of @ref field
+ * @param[in] g - pointer to game structure
+ * @param[in] c - index of the field
+ * @return iterator at the field
+*/
+static inline cell_iter_t position(game_t const *g, size_t c) {
+    cell_iter_t it = { c, 0, 0 };
+    size_t in_tile = c % TILE_CELLS;
+    cells_tile(g, &it);
+    it.x += compact(in_tile & TILE_X);
+    it.y += compact((in_tile & TILE_Y) >> 1);
+    return it;
+}
 
-            g->players[player - 1].completed_moves++;
-            g->players[player - 1].boundary += 
-                        isSurrounded(g->board, g->width, g->height, 0, x, y);
-            g->players[player - 1].boundary -= 
-                        common_free_fields(g->board, g->width, g->height, player, x, y);
-            g->players[player - 1].boundary -= 
-                        diagonal_neighbours(g, player, x, y);
+#endif
 
-            update_strangers(g, player, x, y);
+/** @brief on_board.
+ * @param[in] g - pointer to game structure
+ * @param[in] it - iterator
+ * @return @p true if the field of @p it is not a part of the border
+*/
+static inline bool on_board(game_t const *g, cell_iter_t const *it) {
+    return it->x - BORDER < g->width && it->y - BORDER < g->height;
+}
 
-            return true;
+/** @brief set_border.
+ * Fills the border of the board with SENTINEL
+ * @param[in] g - pointer to game structure
+*/
+static void set_border(game_t *g) {
+#ifndef GAME_TILED
+    // only fields of the border are visited in the column-major layout
+    size_t columns = g->cells / g->stride;
+    for (size_t x = 0; x < columns; x++) {
+        pair_t * column = g->board + x * g->stride;
+        if (x < BORDER || x >= columns - BORDER) {
+            for (size_t y = 0; y < g->stride; y++) { column[y].player = SENTINEL; }
+        } else {
+            for (size_t y = 0; y < BORDER; y++) {
+                column[y].player = SENTINEL;
+                column[g->stride - 1 - y].player = SENTINEL;
+            }
         }
     }
+#else
+    for (cell_iter_t it = cells_begin(g); it.c < g->cells; cells_next(g, &it)) {
+        if (!on_board(g, &it)) { g->board[it.c].player = SENTINEL; }
+    }
+#endif
+}
 
-    find_neighbours(g, player, x, y);
+/** @brief Parts of game's memory
+ * players, areas, dirty, undo, board - offsets of players, area_list,
+ *                                      dirty, undo and board
+ * area_cap - number of records in area_list
+ * undo_cap - number of records in undo
+ * size - bytes needed with the slack for alignment of the beginning
+*/
+struct plan {
+    size_t players;
+    size_t areas;
+    size_t dirty;
+    size_t undo;
+    size_t board;
+    uint32_t area_cap;
+    uint32_t undo_cap;
+    size_t size;
+};
+typedef struct plan plan_t;
 
-    if (different_areas(g->neighbours, around) == 1) {
-        if (around > 1) { g->players[player - 1].busy_areas -= around - 1; }
-        // adjust to existing area
-        for (int i = 0; i < 4; i++) {
-            if (g->neighbours[i]) {
-                g->board[x][y].player = player;
-                g->board[x][y].parent_id = g->neighbours[i];
-                g->players[player - 1].boundary--;
-                break;
-            }
-        }
-    } else {
-        // union at least 2 areas
+/** @brief dirty_words.
+ * @param[in] cells - number of fields of the padded board
+ * @return number of words of the dirty bitmap
+*/
+static inline size_t dirty_words(size_t cells) {
+    return (cells >> DIRTY_SHIFT >> 6) + 1;
+}
 
-        g->board[x][y].player = player;
-        g->board[x][y].parent_id = set_id(g->neighbours);
-        g->players[player - 1].busy_areas -= 
-                    different_areas(g->neighbours, around) - 1;
+/** @brief mark_dirty.
+ * Marks the block of field @p c to be cleared by @ref game_reset
+ * @param[in,out] g - pointer to game structure
+ * @param[in] c - index of the field
+*/
+static inline void mark_dirty(game_t *g, size_t c) {
+    g->dirty[c >> DIRTY_SHIFT >> 6] |= (uint64_t) 1 << ((c >> DIRTY_SHIFT) & 63);
+}
 
-        g->players[player - 1].boundary--;
+/** @brief align_up.
+ * @param[in] n - offset
+ * @return @p n rounded up to ALIGN
+*/
+static inline size_t align_up(size_t n) {
+    return (n + ALIGN - 1) & ~(size_t) (ALIGN - 1);
+}
 
-        BFS(g, g->board[x][y].parent_id, player, x - 1, y);
-        BFS(g, g->board[x][y].parent_id, player, x + 1, y);
-        BFS(g, g->board[x][y].parent_id, player, x, y - 1);
-        BFS(g, g->board[x][y].parent_id, player, x, y + 1);
-    }
+/** @brief plan_game.
+ * Places the parts of the game in one block. Records of areas are
+ * enough for every area that can exist at the same time: each player
+ * has at most @p areas of them and each has at least one field.
+ * @param[in] width - board's width
+ * @param[in] height - board's height
+ * @param[in] players - number of players
+ * @param[in] areas - limit of player's areas
+ * @param[out] plan - the parts
+ * @param[out] shape - structure with board's stride and cells
+ * @return @p true if parameters are correct and the size
+ * does not overflow
+*/
+static bool plan_game(uint32_t width, uint32_t height, uint32_t players,
+                      uint32_t areas, plan_t *plan, game_t *shape) {
+    if (!width || !height || !players || !areas) { return false; }
+    if (players > MAX_PLAYERS) { return false; }
 
-    // update game's info
+    // the padded board must not overflow size_t
+    uint64_t columns = (uint64_t) width + 2 * BORDER + ALIGN;
+    uint64_t rows = (uint64_t) height + 2 * BORDER + ALIGN;
+    if (columns > SIZE_MAX / sizeof(pair_t) / rows) { return false; }
+    shape->width = width;
+    shape->height = height;
+    layout(shape);
 
-    g->players[player - 1].completed_moves++;
+    uint64_t fields = (uint64_t) width * height;
+    uint64_t live = (uint64_t) players * areas;
+    if (live > fields) { live = fields; }
+    if (live >= PATH_ID) { live = PATH_ID - 1; }
+    plan->area_cap = (uint32_t) live + 1;
 
-    g->players[player - 1].boundary += 
-                isSurrounded(g->board, g->width, g->height, 0, x, y);
-    g->players[player - 1].boundary -= 
-                common_free_fields(g->board, g->width, g->height, player, x, y);
-    g->players[player - 1].boundary -= 
-                diagonal_neighbours(g, player, x, y);
+    plan->players = align_up(sizeof(game_t));
+    plan->areas = align_up(plan->players + players * sizeof(player_t));
+    size_t areas_bytes = (size_t) plan->area_cap * sizeof(area_t);
+    if (areas_bytes / sizeof(area_t) != plan->area_cap) { return false; }
+    if (plan->areas > SIZE_MAX - areas_bytes - ALIGN) { return false; }
+    plan->dirty = align_up(plan->areas + areas_bytes);
 
-    update_strangers(g, player, x, y);
+    // the log of moves is bounded, the board is cleared by blocks
+    size_t dirty_bytes = dirty_words(shape->cells) * sizeof(uint64_t);
+    plan->undo_cap = fields < GAME_UNDO_MOVES ? (uint32_t) fields : GAME_UNDO_MOVES;
+    size_t undo_bytes = (size_t) plan->undo_cap * sizeof(undo_t);
+    if (plan->dirty > SIZE_MAX - dirty_bytes - undo_bytes - 2 * ALIGN) { return false; }
+    plan->undo = align_up(plan->dirty + dirty_bytes);
+    plan->board = align_up(plan->undo + undo_bytes);
 
+    size_t board_bytes = shape->cells * sizeof(pair_t);
+    if (plan->board > SIZE_MAX - board_bytes - ALIGN) { return false; }
+    plan->size = plan->board + board_bytes + ALIGN - 1;
     return true;
 }
 
-uint64_t game_busy_fields(game_t const *g, uint32_t player) {
-    return (g == NULL || g->players == NULL || g->players_num < player)
-           ? 0 : g->players[player - 1].completed_moves;
-}
+/** @brief init_game.
+ * Builds the initial state of the game in the block
+ * @param[in] memory - block of at least plan->size bytes
+ * @param[in] plan - parts of the block
+ * @param[in] shape - board's stride and cells from @ref plan_game
+ * @param[in] players - number of players
+ * @param[in] areas - limit of player's areas
+ * @param[in] zeroed - the block comes from calloc or mmap and is filled
+ *                     with zeros, its board's pages are not touched then
+ * @return pointer to the game at the first aligned byte of @p memory
+*/
+static game_t * init_game(void *memory, plan_t const *plan, game_t const *shape,
+                          uint32_t players, uint32_t areas, bool zeroed) {
+    char * base = (char *) memory + (align_up((uintptr_t) memory) - (uintptr_t) memory);
+    game_t * g = (game_t *) base;
+    memset(g, 0, sizeof(game_t));
 
-uint64_t game_free_fields(game_t const *g, uint32_t player) {
-    if (g == NULL || g->players == NULL || g->players_num < player) { return 0; }
+    g->width = shape->width;
+    g->height = shape->height;
+    g->stride = shape->stride;
+    g->cells = shape->cells;
+    g->areas = areas;
 
-    player_t player_tmp = g->players[player - 1];
-    if (player_tmp.busy_areas == g->areas) {
-        return player_tmp.boundary;
-    } else {
-        uint64_t all_fields = (uint64_t) g->height * (uint64_t) g->width;
-        uint64_t busy_fields_all = 0;
-        for (uint32_t p = 0; p < g->players_num; p++) {
-            busy_fields_all += (uint64_t) g->players[p].completed_moves;
-        }
-        return all_fields - busy_fields_all;
+    g->players_num = players;
+    g->turn = 1;
+    g->players = (player_t *) (base + plan->players);
+    g->board = (pair_t *) (base + plan->board);
+    if (!zeroed) {
+        memset(g->players, 0, players * sizeof(player_t));
+        memset(g->board, 0, g->cells * sizeof(pair_t));
     }
-}
+    set_border(g);
 
-uint32_t game_board_width(game_t const *g) {
-    return g == NULL ? 0 : g->width;
+    g->area_list = (area_t *) (base + plan->areas);
+    g->area_cap = plan->area_cap;
+    g->area_top = 1;
+    g->free_area = 0;
+
+    g->dirty = (uint64_t *) (base + plan->dirty);
+    if (!zeroed) { memset(g->dirty, 0, dirty_words(g->cells) * sizeof(uint64_t)); }
+    g->taken = 0;
+
+    g->undo = (undo_t *) (base + plan->undo);
+    g->undo_cap = plan->undo_cap;
+
+    return g;
 }
 
-uint32_t game_board_height(game_t const *g) {
-    return g == NULL ? 0 : g->height;
+size_t game_footprint(uint32_t width, uint32_t height,
+                      uint32_t players, uint32_t areas) {
+    plan_t plan;
+    game_t shape;
+    return plan_game(width, height, players, areas, &plan, &shape) ? plan.size : 0;
 }
 
-uint32_t game_players(game_t const *g) {
-    return g == NULL ? 0 : g->players_num;
+game_t * game_new(uint32_t width, uint32_t height,
+                    uint32_t players, uint32_t areas) {
+    plan_t plan;
+    game_t shape;
+    if (!plan_game(width, height, players, areas, &plan, &shape)) { return NULL; }
+
+    // zero pages of a fresh block are given by the system on first touch
+    void * memory = calloc(1, plan.size);
+    if (memory == NULL) { errno = ENOMEM; return NULL; }
+
+    game_t * g = init_game(memory, &plan, &shape, players, areas, true);
+    g->memory = memory;
+    return g;
 }
 
-char game_player(game_t const *g, uint32_t player) {
-    if (g == NULL || game_players(g) < player || player == 0) { return '.'; }
-    return player <= 9 ? player + '0' : player - 10 + 'a';
+game_t * game_new_in(void *memory, size_t size, uint32_t width, uint32_t height,
+                     uint32_t players, uint32_t areas) {
+    plan_t plan;
+    game_t shape;
+    if (memory == NULL || !plan_game(width, height, players, areas, &plan, &shape)) {
+        return NULL;
+    }
+    if (size < plan.size) { errno = ENOMEM; return NULL; }
+
+    return init_game(memory, &plan, &shape, players, areas, false);
 }
 
-char * game_board(game_t const *g) {
-    if (g == NULL) {
+#ifdef __linux__
+/** @brief map_block.
+ * Maps anonymous memory for @ref game_new_ex and applies the options
+ * @param[in] size - length of the block, multiple of HUGE_PAGE
+ * @param[in] options - the options
+ * @return the block or NULL with @p errno set
+*/
+static void * map_block(size_t size, game_options_t const *options) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (options->pages == GAME_PAGES_HUGE) { flags |= MAP_HUGETLB; }
+    void * memory = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (memory == MAP_FAILED) { return NULL; }
+
+    int err = 0;
+    if (options->pages == GAME_PAGES_TRANSPARENT &&
+        madvise(memory, size, MADV_HUGEPAGE) != 0) {
+        err = errno;
+    }
+    if (!err && options->numa != GAME_NUMA_DEFAULT) {
+        // MPOL_BIND and MPOL_INTERLEAVE of <numaif.h>, which is not always installed
+        int mode = options->numa == GAME_NUMA_BIND ? 2 : 3;
+        unsigned long nodes = (unsigned long) options->nodes;
+        if (syscall(SYS_mbind, memory, size, mode, &nodes,
+                    sizeof(nodes) * 8, 0) != 0) {
+            err = errno;
+        }
+    }
+    if (err) {
+        munmap(memory, size);
+        errno = err;
         return NULL;
     }
+    return memory;
+}
+#endif
 
-    char * board = (char *) malloc((uint64_t) ((uint64_t) g->width + 1)
-                                   * (uint64_t) g->height + 1);
+game_t * game_new_ex(game_options_t const *options) {
+    if (options == NULL) { return NULL; }
+    if (options->pages == GAME_PAGES_DEFAULT && options->numa == GAME_NUMA_DEFAULT) {
+        return game_new(options->width, options->height, options->players,
+                        options->areas);
+    }
+    if (options->pages > GAME_PAGES_HUGE || options->numa > GAME_NUMA_INTERLEAVE ||
+        (options->numa != GAME_NUMA_DEFAULT && options->nodes == 0)) {
+        return NULL;
+    }
 
-    if (board == NULL) {
-        errno = ENOMEM;
+    plan_t plan;
+    game_t shape;
+    if (!plan_game(options->width, options->height, options->players,
+                   options->areas, &plan, &shape)) {
         return NULL;
     }
-    else {
-        uint64_t idx = 0;
-        for (uint32_t i = g->height - 1; i + 1 > 0; i--) {
-            for (uint32_t j = 0; j < g->width; j++) {
-                board[idx] = game_player(g, g->board[j][i].player); idx++;
+#ifdef __linux__
+    if (plan.size > SIZE_MAX - HUGE_PAGE) { return NULL; }
+    size_t size = (plan.size + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+    void * memory = map_block(size, options);
+    if (memory == NULL) { return NULL; }
+
+    game_t * g = init_game(memory, &plan, &shape, options->players,
+                           options->areas, true);
+    g->memory = memory;
+    g->mapped = size;
+    return g;
+#else
+    errno = ENOTSUP;
+    return NULL;
+#endif
+}
+
+void game_delete(game_t *g) {
+    if (g == NULL) { return; }
+#ifdef __linux__
+    if (g->mapped) {
+        munmap(g->memory, g->mapped);
+        return;
+    }
+#endif
+    free(g->memory);
+}
+
+void game_reset(game_t *g) {
+    if (g == NULL) { return; }
+
+    // blocks with a taken field are cleared, the border keeps SENTINEL
+    size_t words = dirty_words(g->cells);
+    for (size_t w = 0; w < words; w++) {
+        for (uint64_t bits = g->dirty[w]; bits; bits &= bits - 1) {
+            size_t from = ((w << 6) + (size_t) __builtin_ctzll(bits)) << DIRTY_SHIFT;
+            size_t to = from + ((size_t) 1 << DIRTY_SHIFT);
+            if (to > g->cells) { to = g->cells; }
+            for (size_t c = from; c < to; c++) {
+                if (g->board[c].player != SENTINEL) { g->board[c] = (pair_t) { 0, 0 }; }
             }
-            board[idx] = '\n'; idx++;
         }
-        board[(uint64_t) ((uint64_t) g->width + 1) * (uint64_t) g->height] = '\0';
+        g->dirty[w] = 0;
+    }
+    g->taken = 0;
+    g->undo_top = 0;
+    g->undo_len = 0;
+    memset(g->players, 0, g->players_num * sizeof(player_t));
+    g->blocked_num = 0;
+    g->turn = 1;
+    g->area_top = 1;
+    g->free_area = 0;
+    g->deferred = false;
+    g->stale = false;
+    g->recount_pool = NULL;
+#ifdef GAME_STATS
+    memset(&g->stats, 0, sizeof(game_stats_t));
+#endif
+}
 
-        return board;
+/** @brief Games of one size class in @ref game_cache
+ * width, height, players, areas - parameters of the games
+ * games - cached games, already reset
+ * count - number of cached games
+*/
+struct cache_class {
+    uint32_t width;
+    uint32_t height;
+    uint32_t players;
+    uint32_t areas;
+    game_t * games[CACHE_GAMES];
+    uint32_t count;
+};
+typedef struct cache_class cache_class_t;
+
+/** @brief Representation of the cache of games
+ * classes - size classes, the recently used ones first
+ * count - number of classes
+*/
+struct game_cache {
+    cache_class_t classes[CACHE_CLASSES];
+    uint32_t count;
+};
+
+game_cache_t * game_cache_new(void) {
+    game_cache_t * cache = (game_cache_t *) calloc(1, sizeof(game_cache_t));
+    if (cache == NULL) { errno = ENOMEM; }
+    return cache;
+}
+
+void game_cache_delete(game_cache_t *cache) {
+    if (cache == NULL) { return; }
+    for (uint32_t i = 0; i < cache->count; i++) {
+        for (uint32_t k = 0; k < cache->classes[i].count; k++) {
+            game_delete(cache->classes[i].games[k]);
+        }
+    }
+    free(cache);
+}
+
+/** @brief cache_find.
+ * Finds the size class and moves it to the front
+ * @param[in,out] cache - the cache
+ * @param[in] width - board's width
+ * @param[in] height - board's height
+ * @param[in] players - number of players
+ * @param[in] areas - limit of player's areas
+ * @return the class or NULL if there is none
+*/
+static cache_class_t * cache_find(game_cache_t *cache, uint32_t width,
+                                  uint32_t height, uint32_t players,
+                                  uint32_t areas) {
+    for (uint32_t i = 0; i < cache->count; i++) {
+        cache_class_t * c = &cache->classes[i];
+        if (c->width == width && c->height == height &&
+            c->players == players && c->areas == areas) {
+            if (i > 0) {
+                cache_class_t found = *c;
+                memmove(&cache->classes[1], &cache->classes[0],
+                        i * sizeof(cache_class_t));
+                cache->classes[0] = found;
+            }
+            return &cache->classes[0];
+        }
+    }
+    return NULL;
+}
+
+game_t * game_cache_get(game_cache_t *cache, uint32_t width, uint32_t height,
+                        uint32_t players, uint32_t areas) {
+    if (cache != NULL) {
+        cache_class_t * c = cache_find(cache, width, height, players, areas);
+        if (c != NULL && c->count > 0) { return c->games[--c->count]; }
+    }
+    return game_new(width, height, players, areas);
+}
+
+void game_cache_put(game_cache_t *cache, game_t *g) {
+    if (g == NULL) { return; }
+    if (cache == NULL || g->memory == NULL) { game_delete(g); return; }
+
+    cache_class_t * c = cache_find(cache, g->width, g->height,
+                                   g->players_num, g->areas);
+    if (c == NULL) {
+        // the least recently used class is dropped when there is no room
+        if (cache->count == CACHE_CLASSES) {
+            cache_class_t * last = &cache->classes[--cache->count];
+            for (uint32_t k = 0; k < last->count; k++) { game_delete(last->games[k]); }
+        }
+        memmove(&cache->classes[1], &cache->classes[0],
+                cache->count * sizeof(cache_class_t));
+        cache->count++;
+        c = &cache->classes[0];
+        *c = (cache_class_t) { g->width, g->height, g->players_num, g->areas,
+                               { NULL }, 0 };
+    }
+    if (c->count == CACHE_GAMES) { game_delete(g); return; }
+
+    game_reset(g);
+    c->games[c->count++] = g;
+}
+
+/** @brief valid_coordinate 
+ * defines whether the fields exists
+ * @param[in] width - board width
+ * @param[in] height - board height
+ * @param[in] x - column's number
+ * @param[in] y - row's number 
+ * @return @p true if fields exists and 
+ * @p false if coordinates are incorrect
+*/
+static bool valid_coordinate(uint32_t width, uint32_t height,
+                                uint32_t x, uint32_t y) {
+    return !(x >= width || y >= height);
+}
+
+/** @brief isSurrounded.
+ * Calculates symbol of fields that connects to <x,y> 
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] c - index of <x,y>
+ * @return number of player's fields around <x,y>
+*/
+static inline uint32_t isSurrounded(game_t const *g, uint32_t player, size_t c) {
+    pair_t const * board = g->board;
+    return (uint32_t) (board[left(g, c)].player == player)
+           + (board[right(g, c)].player == player)
+           + (board[down(g, c)].player == player)
+           + (board[up(g, c)].player == player);
+}
+
+/** @brief common_free_field.
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] f - index of the field
+ * @return 1 if the field is free and touches a field of the player
+*/
+static inline uint32_t common_free_field(game_t const *g, uint32_t player, size_t f) {
+    return (uint32_t) (g->board[f].player == 0)
+           & (uint32_t) (isSurrounded(g, player, f) != 0);
+}
+
+/** @brief common_free_fields.
+ * Calculates free fields next to <x,y> that already touch
+ * another field of the player (distance "2" or a diagonal)
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] c - index of <x,y>
+ * @return number of free fields shared with player's fields
+*/
+static inline uint32_t common_free_fields(game_t const *g, uint32_t player, size_t c) {
+    return common_free_field(g, player, left(g, c))
+           + common_free_field(g, player, right(g, c))
+           + common_free_field(g, player, down(g, c))
+           + common_free_field(g, player, up(g, c));
+}
+
+/** @brief update_blocked.
+ * A player who used all areas can move only next to them, so the player is
+ * blocked when the boundary drops to zero. Every change of the boundary
+ * or of busy areas in the exact mode calls this function, which keeps
+ * the number of blocked players without looking at the board.
+ * @param[in,out] g - pointer to game structure
+ * @param[in] player - player's number
+*/
+static inline void update_blocked(game_t *g, uint32_t player) {
+    player_t * p = &g->players[player - 1];
+    bool blocked = p->busy_areas == g->areas && p->boundary == 0;
+    if (blocked != p->blocked) {
+        p->blocked = blocked;
+        if (blocked) { g->blocked_num++; } else { g->blocked_num--; }
+    }
+}
+
+/** @brief update_strangers_boundary 
+ * decreases perimeter of the area on field @p f and boundary
+ * of its owner whether it is a different player seen for the first time
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] f - index of the field
+ * @param[in,out] seen - players whose boundary was already decreased
+ * @param[in,out] seen_num - number of elements in @p seen
+*/
+static inline void update_strangers_boundary(game_t *g, uint32_t player, size_t f,
+                                             uint32_t * seen, uint32_t * seen_num) {
+    uint32_t stranger = g->board[f].player;
+    if (!stranger || stranger == SENTINEL) { return; }
+    g->area_list[g->board[f].parent_id].info.perimeter--;
+    if (stranger == player) { return; }
+    for (uint32_t i = 0; i < *seen_num; i++) {
+        if (seen[i] == stranger) { return; }
+    }
+    seen[(*seen_num)++] = stranger;
+    g->players[stranger - 1].boundary--;
+    update_blocked(g, stranger);
+}
+
+/** @brief update_strangers.
+ * Helper to @ref update_strangers_boundary.
+ * Field <x,y> stops being free for every area around it.
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] c - index of <x,y>
+ * @return number of different players whose boundary decreased
+*/
+static inline uint32_t update_strangers(game_t *g, uint32_t player, size_t c) {
+    uint32_t seen[4];
+    uint32_t seen_num = 0;
+    update_strangers_boundary(g, player, left(g, c), seen, &seen_num);
+    update_strangers_boundary(g, player, right(g, c), seen, &seen_num);
+    update_strangers_boundary(g, player, down(g, c), seen, &seen_num);
+    update_strangers_boundary(g, player, up(g, c), seen, &seen_num);
+    return seen_num;
+}
+
+/** @brief count_strangers.
+ * Counts different players other than @p player around <x,y>
+ * without changing their counters, used by the deferred mode
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] c - index of <x,y>
+ * @return number of different players
+*/
+static inline uint32_t count_strangers(game_t const *g, uint32_t player, size_t c) {
+    const size_t next[4] = { left(g, c), right(g, c), down(g, c), up(g, c) };
+    uint32_t seen[4];
+    uint32_t seen_num = 0;
+    for (int i = 0; i < 4; i++) {
+        uint32_t q = g->board[next[i]].player;
+        if (!q || q == SENTINEL || q == player) { continue; }
+        uint32_t j = 0;
+        while (j < seen_num && seen[j] != q) { j++; }
+        if (j == seen_num) { seen[seen_num++] = q; }
+    }
+    return seen_num;
+}
+
+/** @brief different_areas.
+ * Calcutes how many different areas are in <x,y> surroundings
+ * @param[in] neighbours - array of surrounding fields
+ * @return different_areas result
+*/
+static uint32_t different_areas(const uint32_t * neighbours) {
+    uint32_t areas = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!neighbours[i]) { continue; }
+        int j = 0;
+        while (j < i && neighbours[j] != neighbours[i]) { j++; }
+        if (j == i) { areas++; }
+    }
+    return areas;
+}
+
+/** @brief step.
+ * @param[in] g - pointer to game structure
+ * @param[in] c - index of the field
+ * @param[in] d - direction: 0 left, 1 right, 2 down, 3 up, d ^ 1 is opposite
+ * @return index of the neighbour in direction @p d
+*/
+static inline size_t step(game_t const *g, size_t c, uint32_t d) {
+    switch (d) {
+        case 0: return left(g, c);
+        case 1: return right(g, c);
+        case 2: return down(g, c);
+        default: return up(g, c);
+    }
+}
+
+/** @brief count_field.
+ * Adds field <x,y> to the statistics of an area
+ * @param[in] g - pointer to game structure
+ * @param[in] c - index of <x,y>
+ * @param[in] x - column's number
+ * @param[in] y - row's number
+ * @param[in,out] a - the statistics or NULL
+*/
+static inline void count_field(game_t const *g, size_t c, uint32_t x, uint32_t y,
+                               game_area_t *a) {
+    if (a == NULL) { return; }
+    a->size++;
+    a->perimeter += isSurrounded(g, 0, c);
+    if (x < a->min_x) { a->min_x = x; }
+    if (y < a->min_y) { a->min_y = y; }
+    if (x > a->max_x) { a->max_x = x; }
+    if (y > a->max_y) { a->max_y = y; }
+}
+
+/** @brief walk_area.
+ * Changes id @p from to @p to on player's fields connected to <x,y>.
+ * Depth-first search without a stack: a field on the path from <x,y>
+ * keeps in parent_id PATH_ID plus the direction back, so areas winding
+ * through the whole board need neither recursion nor memory.
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] from - id of the fields to change
+ * @param[in] to - their new id
+ * @param[in] c - index of <x,y>
+ * @param[in] x - column's number, used only with @p a
+ * @param[in] y - row's number, used only with @p a
+ * @param[in,out] a - statistics of the changed fields or NULL
+*/
+static void walk_area(game_t *g, uint32_t player, uint32_t from, uint32_t to,
+                      size_t c, uint32_t x, uint32_t y, game_area_t *a) {
+    // steps of coordinates in the directions of @ref step, -1 wraps around
+    static const uint32_t dx[4] = { UINT32_MAX, 1, 0, 0 };
+    static const uint32_t dy[4] = { 0, 0, UINT32_MAX, 1 };
+    if (g->board[c].player != player || g->board[c].parent_id != from) { return; }
+    g->board[c].parent_id = PATH_ID + 4;
+    count_field(g, c, x, y, a);
+
+    uint32_t d = 0;
+    for (;;) {
+        if (d < 4) {
+            pair_t * n = &g->board[step(g, c, d)];
+            if (n->player != player || n->parent_id != from) {
+                d++;
+                continue;
+            }
+            n->parent_id = PATH_ID + (d ^ 1);
+            c = step(g, c, d);
+            x += dx[d];
+            y += dy[d];
+            count_field(g, c, x, y, a);
+            d = 0;
+        } else {
+            // all neighbours are done, back to the previous field of the path
+            uint32_t back = g->board[c].parent_id - PATH_ID;
+            g->board[c].parent_id = to;
+            if (back == 4) { return; }
+            c = step(g, c, back);
+            x += dx[back];
+            y += dy[back];
+            d = (back ^ 1) + 1;
+        }
+    }
+}
+
+/** @brief set_id.
+ * defines new id for united area, the largest of the areas
+ * keeps its id so that the smaller ones are relabeled
+ * @param[in] g - pointer to game structure
+ * @return new id
+*/
+static uint32_t set_id(game_t *g) {
+    uint32_t id = 0;
+    for (int i = 0; i < 4; i++) {
+        uint32_t other = g->neighbours[i];
+        if (other && (!id || g->area_list[other].info.size
+                              > g->area_list[id].info.size)) {
+            id = other;
+        }
+    }
+    return id;
+}
+
+/** @brief find_neighbours.
+ * Search if fields around belongs to same player and writes field id
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] c - index of <x,y>
+*/
+static inline void find_neighbours(game_t *g, uint32_t player, size_t c) {
+    const size_t next[4] = { left(g, c), right(g, c), down(g, c), up(g, c) };
+    for (int i = 0; i < 4; i++) {
+        pair_t const * f = &g->board[next[i]];
+        g->neighbours[i] = f->player == player ? f->parent_id : 0;
+    }
+}
+
+/** @brief reserve_area.
+ * Makes sure there is an unused area record, the table is sized
+ * in advance so it fails only when the game is inconsistent
+ * @param[in] g - pointer to game structure
+ * @return @p true on success and @p false
+ * if there is no record left
+*/
+static bool reserve_area(game_t *g) {
+    if (g->free_area || g->area_top < g->area_cap) { return true; }
+    errno = ENOMEM;
+    return false;
+}
+
+/** @brief new_area.
+ * Takes an unused record and puts it on player's list
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] x - column's number
+ * @param[in] y - row's number
+ * @return id of the new area
+*/
+static uint32_t new_area(game_t *g, uint32_t player, uint32_t x, uint32_t y) {
+    uint32_t id = g->free_area;
+    if (id) {
+        g->free_area = g->area_list[id].next;
+    } else {
+        id = g->area_top++;
+    }
+    area_t * a = &g->area_list[id];
+
+    a->info.size = 0;
+    a->info.perimeter = 0;
+    a->info.min_x = a->info.max_x = x;
+    a->info.min_y = a->info.max_y = y;
+    a->player = player;
+    a->prev = 0;
+    a->next = g->players[player - 1].first_area;
+    if (a->next) { g->area_list[a->next].prev = id; }
+    g->players[player - 1].first_area = id;
+    return id;
+}
+
+/** @brief drop_area.
+ * Removes area from player's list and marks its record unused
+ * @param[in] g - pointer to game structure
+ * @param[in] id - id of the area
+*/
+static void drop_area(game_t *g, uint32_t id) {
+    area_t * a = &g->area_list[id];
+    if (a->prev) {
+        g->area_list[a->prev].next = a->next;
+    } else {
+        g->players[a->player - 1].first_area = a->next;
+    }
+    if (a->next) { g->area_list[a->next].prev = a->prev; }
+
+    a->player = 0;
+    a->next = g->free_area;
+    g->free_area = id;
+}
+
+/** @brief merge_areas.
+ * Unites areas around <x,y> with area @p id
+ * @param[in] g - pointer to game structure
+ * @param[in] id - id of united area
+ * @param[in] player - player's number
+ * @param[in] c - index of <x,y>
+*/
+static void merge_areas(game_t *g, uint32_t id, uint32_t player, size_t c) {
+    const size_t next[4] = { left(g, c), right(g, c), down(g, c), up(g, c) };
+    game_area_t * to = &g->area_list[id].info;
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t other = g->neighbours[i];
+        if (!other || other == id) { continue; }
+
+        int j = 0;
+        while (j < i && g->neighbours[j] != other) { j++; }
+        if (j < i) { continue; }
+
+        game_area_t * from = &g->area_list[other].info;
+        to->size += from->size;
+        to->perimeter += from->perimeter;
+        if (from->min_x < to->min_x) { to->min_x = from->min_x; }
+        if (from->min_y < to->min_y) { to->min_y = from->min_y; }
+        if (from->max_x > to->max_x) { to->max_x = from->max_x; }
+        if (from->max_y > to->max_y) { to->max_y = from->max_y; }
+
+        STATS_MERGE(g, from->size);
+        drop_area(g, other);
+        g->players[player - 1].busy_areas--;
+
+        walk_area(g, player, other, id, next[i], 0, 0, NULL);
+    }
+}
+
+/** @brief Work of @ref recount
+ * g - pointer to game structure
+ * shared - tasks run on several threads at once
+*/
+struct recount_job {
+    game_t * g;
+    bool shared;
+};
+typedef struct recount_job recount_job_t;
+
+/** @brief add_counter.
+ * Adds to a counter that can be changed by other tasks of the recount
+ * @param[in,out] counter - the counter
+ * @param[in] n - added value
+ * @param[in] shared - other threads can change the counter at the same time
+*/
+static inline void add_counter(uint64_t *counter, uint64_t n, bool shared) {
+#ifdef __GNUC__
+    if (shared) {
+        __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+        return;
+    }
+#else
+    (void) shared;
+#endif
+    *counter += n;
+}
+
+/** @brief recount_band.
+ * Task of @ref recount, visits free fields of BAND_COLUMNS columns
+ * and adds them to boundaries and perimeters around them
+ * @param[in] arg - the recount_job_t
+ * @param[in] task - number of the band
+*/
+static void recount_band(void *arg, uint32_t task) {
+    recount_job_t const * job = (recount_job_t const *) arg;
+    game_t * g = job->g;
+    uint64_t boundary[MAX_PLAYERS] = { 0 };
+
+    uint32_t x0 = task * BAND_COLUMNS;
+    uint32_t x1 = g->width - x0 < BAND_COLUMNS ? g->width : x0 + BAND_COLUMNS;
+    for (uint32_t x = x0; x < x1; x++) {
+        size_t c = field(g, x, 0);
+        for (uint32_t y = 0; y < g->height; y++, c = up(g, c)) {
+            if (g->board[c].player != 0) { continue; }
+            uint32_t seen[4];
+            uint32_t seen_num = 0;
+            const size_t next[4] = { left(g, c), right(g, c), down(g, c), up(g, c) };
+            for (int i = 0; i < 4; i++) {
+                pair_t const * n = &g->board[next[i]];
+                if (n->player == 0 || n->player == SENTINEL) { continue; }
+                add_counter(&g->area_list[n->parent_id].info.perimeter, 1, job->shared);
+                uint32_t j = 0;
+                while (j < seen_num && seen[j] != n->player) { j++; }
+                if (j == seen_num) {
+                    seen[seen_num++] = n->player;
+                    boundary[n->player - 1]++;
+                }
+            }
+        }
+    }
+    for (uint32_t p = 0; p < g->players_num; p++) {
+        if (boundary[p]) { add_counter(&g->players[p].boundary, boundary[p], job->shared); }
+    }
+}
+
+/** @brief recount.
+ * Counts boundaries of players and perimeters of areas from the board
+ * @param[in,out] g - pointer to game structure
+ * @param[in] pool - threads of the recount or NULL
+*/
+static void recount(game_t *g, game_pool_t *pool) {
+    STATS_BEGIN(start);
+    for (uint32_t p = 0; p < g->players_num; p++) { g->players[p].boundary = 0; }
+    // unused records are cleared too, it is faster than following the lists
+    for (uint32_t id = 1; id < g->area_top; id++) { g->area_list[id].info.perimeter = 0; }
+#ifndef __GNUC__
+    // counters are shared without atomic operations
+    pool = NULL;
+#endif
+    recount_job_t job = { g, game_pool_threads(pool) > 1 };
+    game_pool_run(pool, (g->width - 1) / BAND_COLUMNS + 1, recount_band, &job);
+    g->blocked_num = 0;
+    for (uint32_t p = 0; p < g->players_num; p++) {
+        g->players[p].blocked = false;
+        update_blocked(g, p + 1);
+    }
+    g->stale = false;
+    STATS_END(g, GAME_STATS_RECOUNT, start);
+}
+
+/** @brief settle.
+ * Recounts counters skipped by moves of the deferred mode,
+ * changes only cached values so it is called by queries
+ * @param[in] g - pointer to game structure
+*/
+static inline void settle(game_t const *g) {
+    if (g->stale) { recount((game_t *) g, g->recount_pool); }
+}
+
+/** @brief settle_blocked.
+ * Makes flags of blocked players valid. Only a player who used all
+ * areas can be blocked, so without such a player the board is not
+ * recounted and nobody is blocked while the counters are stale
+ * @param[in] g - pointer to game structure
+*/
+static inline void settle_blocked(game_t const *g) {
+    if (!g->stale) { return; }
+    for (uint32_t p = 0; p < g->players_num; p++) {
+        if (g->players[p].busy_areas == g->areas) {
+            settle(g);
+            return;
+        }
+    }
+}
+
+/** @brief check_move.
+ * Legality part of @ref move, does not change the game
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] x - column's number
+ * @param[in] y - row's number
+ * @param[out] around - number of player's fields around <x,y>
+ * @return @p GAME_MOVE_OK if the move is legal
+ * and reason of rejection otherwise
+*/
+static inline game_move_result_t check_move(game_t const *g, uint32_t player,
+                                            uint32_t x, uint32_t y,
+                                            uint32_t *around) {
+    // game structure correctness
+    if (g == NULL || g->players == NULL) { return GAME_MOVE_NO_GAME; }
+    if (player == 0 || g->players_num < player) { return GAME_MOVE_PLAYER; }
+    // coordinates correctness
+    if (!valid_coordinate(g->width, g->height, x, y)) { return GAME_MOVE_RANGE; }
+    // free field
+    size_t c = field(g, x, y);
+    if (g->board[c].player != 0) { return GAME_MOVE_OCCUPIED; }
+
+    *around = isSurrounded(g, player, c);
+    // is an "island"
+    if (!*around && g->players[player - 1].busy_areas == g->areas) {
+        return GAME_MOVE_AREAS;
+    }
+    return GAME_MOVE_OK;
+}
+
+/** @brief move.
+ * Sets player's pawn on <x,y>, common part of
+ * @ref game_move and @ref game_move_ex
+ * @param[in,out] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] x - column's number
+ * @param[in] y - row's number
+ * @param[out] info - changes of counters, can be NULL
+ * @return result of the move
+*/
+static inline game_move_result_t move(game_t *g, uint32_t player,
+                                      uint32_t x, uint32_t y,
+                                      game_move_info_t *info) {
+    if (g == NULL || g->players == NULL) { return GAME_MOVE_NO_GAME; }
+    STATS_BEGIN(start);
+
+    uint32_t around = 0;
+    game_move_result_t result = check_move(g, player, x, y, &around);
+    if (result == GAME_MOVE_OK && !around && !reserve_area(g)) {
+        result = GAME_MOVE_MEMORY;
+    }
+    if (result != GAME_MOVE_OK) {
+        STATS_REJECT(g, result, start);
+        return result;
+    }
+
+    player_t * p = &g->players[player - 1];
+    size_t c = field(g, x, y);
+
+    // update boundaries while <x,y> is still free
+
+    STATS_BEGIN(boundary);
+    uint32_t free_around = 0;
+    uint32_t common = 0;
+    uint32_t strangers = 0;
+    if (!g->deferred) {
+        free_around = isSurrounded(g, 0, c);
+        common = common_free_fields(g, player, c);
+        p->boundary += free_around;
+        p->boundary -= common;
+        if (around) { p->boundary--; }
+
+        strangers = update_strangers(g, player, c);
+    } else {
+        // counters are recounted when asked for, only info is computed
+        g->stale = true;
+        if (info != NULL) {
+            free_around = isSurrounded(g, 0, c);
+            common = common_free_fields(g, player, c);
+            strangers = count_strangers(g, player, c);
+        }
+    }
+    STATS_END(g, GAME_STATS_BOUNDARY, boundary);
+
+    uint32_t id;
+    uint32_t merged = 0;
+    if (!around) {
+        id = new_area(g, player, x, y);
+        p->busy_areas++;
+    } else {
+        // adjust to existing area or union at least 2 areas
+        find_neighbours(g, player, c);
+        id = set_id(g);
+        merged = different_areas(g->neighbours) - 1;
+        if (merged) {
+            STATS_BEGIN(merge);
+            merge_areas(g, id, player, c);
+            STATS_END(g, GAME_STATS_MERGE, merge);
+        }
+    }
+
+    // update game's info
+
+    g->board[c].player = player;
+    g->board[c].parent_id = id;
+    g->taken++;
+    mark_dirty(g, c);
+    g->undo[g->undo_top] = (undo_t) { c, g->turn };
+    if (++g->undo_top == g->undo_cap) { g->undo_top = 0; }
+    if (g->undo_len < g->undo_cap) { g->undo_len++; }
+
+    game_area_t * a = &g->area_list[id].info;
+    a->size++;
+    if (!g->deferred) { a->perimeter += free_around; }
+    if (x < a->min_x) { a->min_x = x; }
+    if (y < a->min_y) { a->min_y = y; }
+    if (x > a->max_x) { a->max_x = x; }
+    if (y > a->max_y) { a->max_y = y; }
+
+    p->completed_moves++;
+    if (!g->deferred) { update_blocked(g, player); }
+
+    if (info != NULL) {
+        info->boundary = (int64_t) free_around - common - (around ? 1 : 0);
+        info->areas = around ? -(int32_t) merged : 1;
+        info->merged = merged;
+        info->strangers = strangers;
+    }
+
+    STATS_END(g, GAME_STATS_MOVE, start);
+    return GAME_MOVE_OK;
+}
+
+bool game_move(game_t *g, uint32_t player, uint32_t x, uint32_t y) {
+    return move(g, player, x, y, NULL) == GAME_MOVE_OK;
+}
+
+game_move_result_t game_move_ex(game_t *g, uint32_t player,
+                                uint32_t x, uint32_t y, game_move_info_t *info) {
+    return move(g, player, x, y, info);
+}
+
+/** @brief restore_strangers.
+ * Inverse of @ref update_strangers, field <x,y> is free again
+ * for every area of other players around it
+ * @param[in] g - pointer to game structure
+ * @param[in] player - player's number
+ * @param[in] c - index of <x,y>
+*/
+static void restore_strangers(game_t *g, uint32_t player, size_t c) {
+    const size_t next[4] = { left(g, c), right(g, c), down(g, c), up(g, c) };
+    uint32_t seen[4];
+    uint32_t seen_num = 0;
+    for (int i = 0; i < 4; i++) {
+        pair_t const * f = &g->board[next[i]];
+        if (!f->player || f->player == SENTINEL || f->player == player) { continue; }
+        g->area_list[f->parent_id].info.perimeter++;
+        uint32_t j = 0;
+        while (j < seen_num && seen[j] != f->player) { j++; }
+        if (j == seen_num) {
+            seen[seen_num++] = f->player;
+            g->players[f->player - 1].boundary++;
+            update_blocked(g, f->player);
+        }
+    }
+}
+
+bool game_undo(game_t *g) {
+    if (g == NULL || g->players == NULL || g->undo_len == 0) { return false; }
+
+    g->undo_top = (g->undo_top ? g->undo_top : g->undo_cap) - 1;
+    g->undo_len--;
+    g->taken--;
+    size_t c = g->undo[g->undo_top].c;
+    uint32_t player = g->board[c].player;
+    uint32_t id = g->board[c].parent_id;
+    player_t * p = &g->players[player - 1];
+    g->board[c] = (pair_t) { 0, 0 };
+    p->completed_moves--;
+
+    // the same counts as in the move, <x,y> is free again
+    if (!g->deferred) {
+        uint32_t free_around = isSurrounded(g, 0, c);
+        uint32_t common = common_free_fields(g, player, c);
+        uint32_t around = isSurrounded(g, player, c);
+        p->boundary += common + (around ? 1 : 0);
+        p->boundary -= free_around;
+        restore_strangers(g, player, c);
+    } else {
+        g->stale = true;
+    }
+
+    // the area falls apart into the parts around <x,y>, the first keeps its id
+    cell_iter_t at = position(g, c);
+    uint32_t x = at.x - BORDER;
+    uint32_t y = at.y - BORDER;
+    const pending_t next[4] = {
+        { left(g, c), x - 1, y }, { right(g, c), x + 1, y },
+        { down(g, c), x, y - 1 }, { up(g, c), x, y + 1 }
+    };
+    for (int i = 0; i < 4; i++) { walk_area(g, player, id, 0, next[i].c, 0, 0, NULL); }
+
+    uint32_t parts = 0;
+    for (int i = 0; i < 4; i++) {
+        pair_t const * f = &g->board[next[i].c];
+        if (f->player != player || f->parent_id) { continue; }
+        uint32_t part = id;
+        if (parts++) {
+            part = new_area(g, player, next[i].x, next[i].y);
+        } else {
+            g->area_list[id].info = (game_area_t) { 0, 0, next[i].x, next[i].y,
+                                                    next[i].x, next[i].y };
+        }
+        walk_area(g, player, 0, part, next[i].c, next[i].x, next[i].y,
+                  &g->area_list[part].info);
+    }
+    if (parts) {
+        p->busy_areas += parts - 1;
+    } else {
+        drop_area(g, id);
+        p->busy_areas--;
+    }
+    if (!g->deferred) { update_blocked(g, player); }
+    // game_play passes the turn after the move, game_move leaves it
+    g->turn = g->undo[g->undo_top].turn;
+    return true;
+}
+
+bool game_set_boundary(game_t *g, game_boundary_t mode, game_pool_t *pool) {
+    if (g == NULL || g->players == NULL || mode > GAME_BOUNDARY_DEFERRED) {
+        return false;
+    }
+    if (mode == GAME_BOUNDARY_EXACT) {
+        if (g->stale) { recount(g, pool); }
+        g->deferred = false;
+        g->recount_pool = NULL;
+    } else {
+        g->deferred = true;
+        g->recount_pool = pool;
+    }
+    return true;
+}
+
+uint64_t game_busy_fields(game_t const *g, uint32_t player) {
+    return (g == NULL || g->players == NULL || player == 0 || g->players_num < player)
+           ? 0 : g->players[player - 1].completed_moves;
+}
+
+uint64_t game_free_fields(game_t const *g, uint32_t player) {
+    if (g == NULL || g->players == NULL || player == 0 || g->players_num < player) {
+        return 0;
+    }
+
+    player_t player_tmp = g->players[player - 1];
+    if (player_tmp.busy_areas == g->areas) {
+        settle(g);
+        player_tmp = g->players[player - 1];
+        return player_tmp.boundary;
+    } else {
+        // every pawn is counted in taken
+        return (uint64_t) g->height * (uint64_t) g->width - g->taken;
+    }
+}
+
+bool game_is_over(game_t const *g) {
+    if (g == NULL || g->players == NULL) { return false; }
+    settle_blocked(g);
+    return g->taken == (uint64_t) g->height * (uint64_t) g->width ||
+           (!g->stale && g->blocked_num == g->players_num);
+}
+
+uint32_t game_next_player_with_moves(game_t const *g, uint32_t from) {
+    if (g == NULL || g->players == NULL || g->players_num < from || game_is_over(g)) {
+        return 0;
+    }
+    // someone is not blocked, so the loop stops after at most players_num steps,
+    // flags are valid unless nobody can be blocked, see settle_blocked
+    uint32_t p = from;
+    do {
+        p = p == g->players_num ? 1 : p + 1;
+    } while (!g->stale && g->players[p - 1].blocked);
+    return p;
+}
+
+uint32_t game_current_player(game_t const *g) {
+    if (g == NULL || g->players == NULL) { return 0; }
+    return game_next_player_with_moves(g, g->turn - 1);
+}
+
+bool game_play(game_t *g, uint32_t x, uint32_t y) {
+    uint32_t player = game_current_player(g);
+    if (player == 0 || !game_move(g, player, x, y)) { return false; }
+    g->turn = player % g->players_num + 1;
+    return true;
+}
+
+bool game_pass(game_t *g) {
+    uint32_t player = game_current_player(g);
+    if (player == 0) { return false; }
+    g->turn = player % g->players_num + 1;
+    return true;
+}
+
+bool game_scores(game_t const *g, uint64_t *scores) {
+    if (g == NULL || g->players == NULL || scores == NULL) { return false; }
+    for (uint32_t p = 0; p < g->players_num; p++) {
+        scores[p] = g->players[p].completed_moves;
+    }
+    return true;
+}
+
+bool game_can_move(game_t const *g, uint32_t player, uint32_t x, uint32_t y) {
+    uint32_t around;
+    return check_move(g, player, x, y, &around) == GAME_MOVE_OK;
+}
+
+uint64_t game_can_move_mask(game_t const *g, uint32_t player,
+                            uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+                            uint8_t *mask) {
+    if (g == NULL || g->players == NULL || player == 0 || g->players_num < player) {
+        return 0;
+    }
+    if (mask == NULL || !w || !h || x >= g->width || y >= g->height ||
+        w > g->width - x || h > g->height - y) {
+        return 0;
+    }
+
+    // without the areas' limit every free field is legal
+    bool anywhere = g->players[player - 1].busy_areas < g->areas;
+    uint64_t stride = ((uint64_t) w + 7) / 8;
+    uint64_t legal = 0;
+    memset(mask, 0, stride * h);
+
+    for (uint32_t i = 0; i < w; i++) {
+        size_t f = field(g, x + i, y);
+        uint8_t * byte = mask + i / 8;
+        uint8_t bit = (uint8_t) (1u << (i % 8));
+
+        for (uint32_t j = 0; j < h; j++, f = up(g, f)) {
+            if (g->board[f].player != 0) { continue; }
+            if (anywhere || isSurrounded(g, player, f)) {
+                byte[j * stride] |= bit;
+                legal++;
+            }
+        }
+    }
+    return legal;
+}
+
+/** @brief Work of @ref game_feature_planes_batch
+ * games - the games
+ * out - the tensor
+ * per_game - number of tensor's elements of one game
+ * layout, type - order and type of the elements
+ * failed - a task could not allocate memory
+*/
+struct planes_job {
+    game_t const * const * games;
+    void * out;
+    size_t per_game;
+    game_layout_t layout;
+    game_planes_type_t type;
+    bool failed;
+};
+typedef struct planes_job planes_job_t;
+
+/** @brief owners_grid.
+ * Copies owners of the fields into a row-major grid with a border
+ * of 0xFF, field <x,y> is at (y + 1) * (width + 2) + x + 1
+ * @param[in] g - pointer to game structure
+ * @param[out] grid - (width + 2) * (height + 2) bytes
+*/
+static void owners_grid(game_t const *g, uint8_t *grid) {
+    size_t gw = (size_t) g->width + 2;
+    memset(grid, 0xFF, gw);
+    memset(grid + ((size_t) g->height + 1) * gw, 0xFF, gw);
+    for (uint32_t y = 0; y < g->height; y++) {
+        grid[(y + 1) * gw] = 0xFF;
+        grid[(y + 1) * gw + g->width + 1] = 0xFF;
+    }
+    for (uint32_t x = 0; x < g->width; x++) {
+        size_t c = field(g, x, 0);
+        uint8_t * o = grid + gw + x + 1;
+        for (uint32_t y = 0; y < g->height; y++, c = up(g, c), o += gw) {
+            *o = (uint8_t) g->board[c].player;
+        }
+    }
+}
+
+/** @brief plane_row.
+ * Writes one row of an owner's or a legal moves' plane as bytes 0 or 1
+ * @param[in] row - first field of the row in the grid of @ref owners_grid
+ * @param[in] gw - width of the grid
+ * @param[in] w - width of the board
+ * @param[in] p - player's number
+ * @param[in] legal - the row of legal moves, otherwise of player's fields
+ * @param[in] anywhere - the player can take every free field
+ * @param[out] dst - @p w bytes
+*/
+static void plane_row(uint8_t const *row, size_t gw, size_t w, uint8_t p,
+                      bool legal, bool anywhere, uint8_t *dst) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i player = _mm_set1_epi8((char) p);
+    for (; i + 16 <= w; i += 16) {
+        __m128i o = _mm_loadu_si128((__m128i const *) (row + i));
+        __m128i m;
+        if (!legal) {
+            m = _mm_cmpeq_epi8(o, player);
+        } else {
+            m = _mm_cmpeq_epi8(o, zero);
+            if (!anywhere) {
+                __m128i l = _mm_loadu_si128((__m128i const *) (row + i - 1));
+                __m128i r = _mm_loadu_si128((__m128i const *) (row + i + 1));
+                __m128i d = _mm_loadu_si128((__m128i const *) (row + i - gw));
+                __m128i u = _mm_loadu_si128((__m128i const *) (row + i + gw));
+                __m128i near = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(l, player), _mm_cmpeq_epi8(r, player)),
+                    _mm_or_si128(_mm_cmpeq_epi8(d, player), _mm_cmpeq_epi8(u, player)));
+                m = _mm_and_si128(m, near);
+            }
+        }
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_and_si128(m, one));
+    }
+#endif
+    for (; i < w; i++) {
+        if (!legal) {
+            dst[i] = row[i] == p;
+        } else {
+            dst[i] = row[i] == 0 &&
+                     (anywhere || row[i - 1] == p || row[i + 1] == p ||
+                      row[i - gw] == p || row[i + gw] == p);
+        }
+    }
+}
+
+/** @brief store_floats.
+ * Expands bytes 0 or 1 into floats 0.0 or 1.0
+ * @param[in] bytes - the bytes
+ * @param[out] dst - the floats
+ * @param[in] n - number of elements
+*/
+static void store_floats(uint8_t const *bytes, float *dst, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        // 1 becomes 0xFF and then 32 bits of ones masking 1.0f
+        __m128i m = _mm_sub_epi8(zero, _mm_loadu_si128((__m128i const *) (bytes + i)));
+        __m128i lo = _mm_unpacklo_epi8(m, m);
+        __m128i hi = _mm_unpackhi_epi8(m, m);
+        _mm_storeu_ps(dst + i, _mm_and_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(lo, lo)), one));
+        _mm_storeu_ps(dst + i + 4, _mm_and_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(lo, lo)), one));
+        _mm_storeu_ps(dst + i + 8, _mm_and_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(hi, hi)), one));
+        _mm_storeu_ps(dst + i + 12, _mm_and_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(hi, hi)), one));
+    }
+#endif
+    for (; i < n; i++) { dst[i] = bytes[i]; }
+}
+
+/** @brief planes_nchw.
+ * Writes planes of one game plane after plane
+ * @param[in] g - pointer to game structure
+ * @param[in] grid - owners of @ref owners_grid
+ * @param[out] scratch - width bytes
+ * @param[out] out - elements of the game
+ * @param[in] type - type of the elements
+*/
+static void planes_nchw(game_t const *g, uint8_t const *grid, uint8_t *scratch,
+                        void *out, game_planes_type_t type) {
+    size_t w = g->width;
+    size_t h = g->height;
+    size_t gw = w + 2;
+    for (uint32_t legal = 0; legal < 2; legal++) {
+        for (uint32_t p = 1; p <= g->players_num; p++) {
+            bool anywhere = g->players[p - 1].busy_areas < g->areas;
+            size_t plane = ((size_t) legal * g->players_num + p - 1) * h * w;
+            for (size_t y = 0; y < h; y++) {
+                uint8_t const * row = grid + (y + 1) * gw + 1;
+                size_t at = plane + y * w;
+                if (type == GAME_PLANES_U8) {
+                    plane_row(row, gw, w, (uint8_t) p, legal, anywhere, (uint8_t *) out + at);
+                } else {
+                    plane_row(row, gw, w, (uint8_t) p, legal, anywhere, scratch);
+                    store_floats(scratch, (float *) out + at, w);
+                }
+            }
+        }
+    }
+}
+
+/** @brief planes_nhwc.
+ * Writes planes of one game field after field, a free field starts
+ * from the template of players that can take every free field
+ * @param[in] g - pointer to game structure
+ * @param[in] grid - owners of @ref owners_grid
+ * @param[out] scratch - 4 * players bytes
+ * @param[out] out - elements of the game
+ * @param[in] type - type of the elements
+*/
+static void planes_nhwc(game_t const *g, uint8_t const *grid, uint8_t *scratch,
+                        void *out, game_planes_type_t type) {
+    size_t w = g->width;
+    size_t gw = w + 2;
+    uint32_t players = g->players_num;
+    size_t channels = 2 * (size_t) players;
+    uint8_t * free_field = scratch + channels;
+
+    memset(free_field, 0, channels);
+    for (uint32_t p = 0; p < players; p++) {
+        free_field[players + p] = g->players[p].busy_areas < g->areas;
+    }
+
+    size_t at = 0;
+    for (size_t y = 0; y < g->height; y++) {
+        uint8_t const * row = grid + (y + 1) * gw + 1;
+        for (size_t x = 0; x < w; x++, at += channels) {
+            uint8_t * cell = type == GAME_PLANES_U8 ? (uint8_t *) out + at : scratch;
+            uint8_t o = row[x];
+            if (o != 0) {
+                memset(cell, 0, channels);
+                cell[o - 1] = 1;
+            } else {
+                memcpy(cell, free_field, channels);
+                const uint8_t near[4] = { row[x - 1], row[x + 1], row[x - gw], row[x + gw] };
+                for (int i = 0; i < 4; i++) {
+                    if (near[i] != 0 && near[i] != 0xFF) { cell[players + near[i] - 1] = 1; }
+                }
+            }
+            if (type == GAME_PLANES_F32) { store_floats(cell, (float *) out + at, channels); }
+        }
+    }
+}
+
+/** @brief planes_task.
+ * Task of @ref game_feature_planes_batch, writes planes of one game
+ * @param[in] arg - the planes_job_t
+ * @param[in] task - number of the game
+*/
+static void planes_task(void *arg, uint32_t task) {
+    planes_job_t * job = (planes_job_t *) arg;
+    game_t const * g = job->games[task];
+    size_t grid = ((size_t) g->width + 2) * ((size_t) g->height + 2);
+    size_t scratch = g->width > 4 * g->players_num ? g->width : 4 * g->players_num;
+    uint8_t * memory = (uint8_t *) malloc(grid + scratch);
+    if (memory == NULL) {
+        // tasks only set the flag, so a race between them is harmless
+        job->failed = true;
+        return;
+    }
+
+    size_t element = job->type == GAME_PLANES_U8 ? sizeof(uint8_t) : sizeof(float);
+    void * out = (char *) job->out + (size_t) task * job->per_game * element;
+    owners_grid(g, memory);
+    if (job->layout == GAME_LAYOUT_NCHW) {
+        planes_nchw(g, memory, memory + grid, out, job->type);
+    } else {
+        planes_nhwc(g, memory, memory + grid, out, job->type);
+    }
+    free(memory);
+}
+
+bool game_feature_planes(game_t const *g, void *out, game_layout_t layout,
+                         game_planes_type_t type) {
+    return game_feature_planes_batch(&g, 1, out, layout, type, NULL);
+}
+
+bool game_feature_planes_batch(game_t const * const *games, size_t n, void *out,
+                               game_layout_t layout, game_planes_type_t type,
+                               game_pool_t *pool) {
+    if (games == NULL || out == NULL || layout > GAME_LAYOUT_NHWC ||
+        type > GAME_PLANES_F32 || n > UINT32_MAX) {
+        errno = EINVAL;
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        game_t const * g = games[i];
+        if (g == NULL || g->players == NULL || g->width != games[0]->width ||
+            g->height != games[0]->height || g->players_num != games[0]->players_num) {
+            errno = EINVAL;
+            return false;
+        }
+    }
+    if (n == 0) { return true; }
+
+    game_t const * g = games[0];
+    planes_job_t job = { games, out,
+                         2 * (size_t) g->players_num * g->width * g->height,
+                         layout, type, false };
+    game_pool_run(pool, (uint32_t) n, planes_task, &job);
+    if (job.failed) { errno = ENOMEM; }
+    return !job.failed;
+}
+
+
+uint32_t game_areas(game_t const *g, uint32_t player,
+                    game_area_t *out, uint32_t cap) {
+    if (g == NULL || g->players == NULL || player == 0 || g->players_num < player) {
+        return 0;
+    }
+
+    settle(g);
+    uint32_t n = 0;
+    for (uint32_t id = g->players[player - 1].first_area; id;
+         id = g->area_list[id].next) {
+        if (n < cap) { out[n] = g->area_list[id].info; }
+        n++;
+    }
+    return n;
+}
+
+uint32_t game_board_width(game_t const *g) {
+    return g == NULL ? 0 : g->width;
+}
+
+uint32_t game_board_height(game_t const *g) {
+    return g == NULL ? 0 : g->height;
+}
+
+uint32_t game_players(game_t const *g) {
+    return g == NULL ? 0 : g->players_num;
+}
+
+char game_player(game_t const *g, uint32_t player) {
+    if (g == NULL || game_players(g) < player || player == 0) { return '.'; }
+    return player <= 9 ? player + '0' : player - 10 + 'a';
+}
+
+/** @brief fill_symbols.
+ * Writes symbols of @ref game_player for a free field and every player
+ * @param[in] g - pointer to game structure
+ * @param[out] symbols - array of MAX_PLAYERS + 1 symbols
+*/
+static void fill_symbols(game_t const *g, char *symbols) {
+    for (uint32_t p = 0; p <= g->players_num; p++) { symbols[p] = game_player(g, p); }
+}
+
+char * game_board(game_t const *g) {
+    if (g == NULL) {
+        return NULL;
+    }
+
+    char * board = (char *) malloc((uint64_t) ((uint64_t) g->width + 1)
+                                   * (uint64_t) g->height + 1);
+
+    if (board == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    else {
+        // fields are read in the order of storage, rows from the top one
+        char symbols[MAX_PLAYERS + 1];
+        fill_symbols(g, symbols);
+        uint64_t line = (uint64_t) g->width + 1;
+        uint64_t idx = line * (uint64_t) g->height;
+        for (cell_iter_t it = cells_begin(g); it.c < g->cells; cells_next(g, &it)) {
+            if (!on_board(g, &it)) { continue; }
+            uint64_t row = (uint64_t) g->height - 1 - (it.y - BORDER);
+            board[row * line + it.x - BORDER] = symbols[g->board[it.c].player];
+        }
+        for (uint64_t i = line - 1; i < idx; i += line) { board[i] = '\n'; }
+        board[idx] = '\0';
+        STATS_BOARD(g, idx);
+
+        return board;
+    }
+}
+
+/** @brief Job of @ref game_board_parallel
+ * g - pointer to game structure
+ * board - the description
+ * symbols - symbols of players, symbols[0] is a free field
+*/
+struct render {
+    game_t const * g;
+    char * board;
+    char symbols[MAX_PLAYERS + 1];
+};
+typedef struct render render_t;
+
+/** @brief render_rect.
+ * Writes columns [x0, x1) of @p rows rows of the description, the first
+ * one is row @p top counted from the top. Fields are read column after
+ * column. The new line is added when x1 is the width of the board.
+ * @param[in] g - pointer to game structure
+ * @param[in] symbols - symbols of players, see @ref fill_symbols
+ * @param[out] out - first written byte
+ * @param[in] line - distance between rows in @p out
+ * @param[in] top - first row
+ * @param[in] rows - number of rows
+ * @param[in] x0 - first column
+ * @param[in] x1 - end of the columns
+*/
+static void render_rect(game_t const *g, char const *symbols, char *out,
+                        uint64_t line, uint32_t top, uint32_t rows,
+                        uint32_t x0, uint32_t x1) {
+    uint32_t bottom = g->height - top - rows;
+
+    for (uint32_t x = x0; x < x1; x++) {
+        size_t f = field(g, x, bottom);
+        char * column = out + (x - x0);
+        for (uint32_t j = rows; j-- > 0; f = up(g, f)) {
+            column[line * j] = symbols[g->board[f].player];
+        }
+    }
+    if (x1 == g->width) {
+        for (uint32_t j = 0; j < rows; j++) { out[line * j + (x1 - x0)] = '\n'; }
+    }
+}
+
+/** @brief render_band.
+ * Writes rows [task * BAND_ROWS, (task + 1) * BAND_ROWS) of the description,
+ * counted from the top one
+ * @param[in] arg - job of type render_t
+ * @param[in] task - number of the band
+*/
+static void render_band(void *arg, uint32_t task) {
+    render_t const * r = (render_t const *) arg;
+    game_t const * g = r->g;
+    uint64_t line = (uint64_t) g->width + 1;
+    uint32_t first = task * BAND_ROWS;
+    uint32_t rows = g->height - first < BAND_ROWS ? g->height - first : BAND_ROWS;
+
+    render_rect(g, r->symbols, r->board + line * first, line, first, rows,
+                0, g->width);
+}
+
+char * game_board_parallel(game_t const *g, game_pool_t *pool) {
+    if (g == NULL) { return NULL; }
+
+    uint64_t size = ((uint64_t) g->width + 1) * (uint64_t) g->height;
+    char * board = (char *) malloc(size + 1);
+    if (board == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    render_t r = { .g = g, .board = board };
+    fill_symbols(g, r.symbols);
+    game_pool_run(pool, (g->height + BAND_ROWS - 1) / BAND_ROWS, render_band, &r);
+    board[size] = '\0';
+    STATS_BOARD(g, size);
+    return board;
+}
+
+/** @brief write_ring.
+ * Writes buffers with writev, repeats after partial writes and EINTR
+ * @param[in] fd - file descriptor
+ * @param[in,out] iov - buffers, changed by partial writes
+ * @param[in] count - number of buffers
+ * @return @p true on success and @p false with @p errno set otherwise
+*/
+static bool write_ring(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        while (count > 0 && (size_t) n >= iov->iov_len) {
+            n -= (ssize_t) iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= (size_t) n;
+        }
+    }
+    return true;
+}
+
+bool game_board_write(game_t const *g, int fd) {
+    if (g == NULL) { errno = EINVAL; return false; }
+
+    char * ring = (char *) malloc(WRITE_RING * WRITE_CHUNK);
+    if (ring == NULL) { errno = ENOMEM; return false; }
+    char symbols[MAX_PLAYERS + 1];
+    fill_symbols(g, symbols);
+
+    // whole rows fit in a buffer or a row is split into pieces
+    uint64_t line = (uint64_t) g->width + 1;
+    bool split = line > WRITE_CHUNK;
+    uint32_t piece = split ? WRITE_CHUNK - 1 : g->width;
+    uint32_t rows = split ? 1 : (uint32_t) (WRITE_CHUNK / line);
+
+    struct iovec iov[WRITE_RING];
+    int used = 0;
+    bool ok = true;
+    for (uint32_t top = 0; ok && top < g->height; top += rows) {
+        uint32_t n = g->height - top < rows ? g->height - top : rows;
+        for (uint32_t x0 = 0; ok && x0 < g->width; x0 += piece) {
+            uint32_t x1 = g->width - x0 < piece ? g->width : x0 + piece;
+            uint64_t out_line = (uint64_t) (x1 - x0) + (x1 == g->width);
+            char * buf = ring + (size_t) used * WRITE_CHUNK;
+
+            render_rect(g, symbols, buf, out_line, top, n, x0, x1);
+            iov[used].iov_base = buf;
+            iov[used].iov_len = (size_t) (out_line * n);
+            if (++used == WRITE_RING) {
+                ok = write_ring(fd, iov, used);
+                used = 0;
+            }
+        }
+    }
+    ok = ok && write_ring(fd, iov, used);
+
+    int err = errno;
+    free(ring);
+    errno = err;
+    if (ok) { STATS_BOARD(g, line * g->height); }
+    return ok;
+}
+
+/** @brief Growable output buffer of @ref game_export
+ * data - bytes
+ * size - number of written bytes
+ * cap - capacity of data
+*/
+struct out_buf {
+    uint8_t * data;
+    size_t size;
+    size_t cap;
+};
+typedef struct out_buf out_buf_t;
+
+/** @brief out_reserve.
+ * Makes room for @p n more bytes
+ * @param[in,out] out - buffer
+ * @param[in] n - number of bytes
+ * @return @p true on success and @p false
+ * if memory could not be allocated
+*/
+static bool out_reserve(out_buf_t *out, size_t n) {
+    if (out->cap - out->size >= n) { return true; }
+    size_t cap = out->cap ? out->cap : 4096;
+    while (cap - out->size < n) {
+        if (cap > SIZE_MAX / 2) { return false; }
+        cap *= 2;
+    }
+    uint8_t * data = (uint8_t *) realloc(out->data, cap);
+    if (data == NULL) { return false; }
+    out->data = data;
+    out->cap = cap;
+    return true;
+}
+
+/** @brief out_u32.
+ * Appends a little-endian number, room must be reserved
+ * @param[in,out] out - buffer
+ * @param[in] v - the number
+*/
+static void out_u32(out_buf_t *out, uint32_t v) {
+    for (int i = 0; i < 4; i++) { out->data[out->size++] = (uint8_t) (v >> (8 * i)); }
+}
+
+/** @brief in_u32.
+ * @param[in] in - four bytes
+ * @return little-endian number
+*/
+static uint32_t in_u32(uint8_t const *in) {
+    return (uint32_t) in[0] | (uint32_t) in[1] << 8 | (uint32_t) in[2] << 16
+           | (uint32_t) in[3] << 24;
+}
+
+/** @brief rle_symbol.
+ * @param[in] player - player's number or zero
+ * @return symbol of the field in GAME_FORMAT_RLE
+*/
+static char rle_symbol(uint32_t player) {
+    return player == 0 ? '.' : player <= 26 ? (char) ('A' + player - 1)
+                                            : (char) ('a' + player - 27);
+}
+
+/** @brief rle_player.
+ * @param[in] symbol - symbol of the field in GAME_FORMAT_RLE
+ * @return player's number, zero for a free field
+ * or UINT32_MAX for a wrong symbol
+*/
+static uint32_t rle_player(uint8_t symbol) {
+    if (symbol == '.') { return 0; }
+    if (symbol >= 'A' && symbol <= 'Z') { return symbol - 'A' + 1u; }
+    if (symbol >= 'a' && symbol <= 'i') { return symbol - 'a' + 27u; }
+    return UINT32_MAX;
+}
+
+/** @brief packed_bits.
+ * @param[in] players - number of players
+ * @return number of bits of a field in GAME_FORMAT_PACKED
+*/
+static uint32_t packed_bits(uint32_t players) {
+    uint32_t bits = 1;
+    while ((1u << bits) <= players) { bits++; }
+    return bits;
+}
+
+/** @brief export_rle.
+ * Writes runs of fields column after column. A run ends
+ * at the border, so the scan needs no check of coordinates.
+ * @param[in] g - pointer to game structure
+ * @param[in,out] out - buffer
+ * @return @p true on success and @p false
+ * if memory could not be allocated
+*/
+static bool export_rle(game_t const *g, out_buf_t *out) {
+    if (!out_reserve(out, 64)) { return false; }
+    out->size += (size_t) sprintf((char *) out->data, "GAME %u %u %u %u\n",
+                                  g->width, g->height, g->players_num, g->areas);
+
+    for (uint32_t x = 0; x < g->width; x++) {
+        size_t f = field(g, x, 0);
+        uint32_t player = g->board[f].player;
+        while (player != SENTINEL) {
+            uint32_t run = 0;
+            do {
+                f = up(g, f);
+                run++;
+            } while (g->board[f].player == player);
+
+            if (!out_reserve(out, 12)) { return false; }
+            if (run > 1) {
+                out->size += (size_t) sprintf((char *) out->data + out->size,
+                                              "%u", run);
+            }
+            out->data[out->size++] = (uint8_t) rle_symbol(player);
+            player = g->board[f].player;
+        }
+        if (!out_reserve(out, 1)) { return false; }
+        out->data[out->size++] = '\n';
+    }
+    return true;
+}
+
+/** @brief export_packed.
+ * Writes owners of fields column after column on packed_bits() bits
+ * @param[in] g - pointer to game structure
+ * @param[in,out] out - buffer
+ * @return @p true on success and @p false
+ * if memory could not be allocated
+*/
+static bool export_packed(game_t const *g, out_buf_t *out) {
+    uint32_t bits = packed_bits(g->players_num);
+    uint64_t cells = (uint64_t) g->width * g->height;
+    uint64_t bytes = (cells * bits + 7) / 8;
+    if (bytes > SIZE_MAX - 20 || !out_reserve(out, 20 + (size_t) bytes)) {
+        return false;
+    }
+
+    memcpy(out->data + out->size, "GPK1", 4);
+    out->size += 4;
+    out_u32(out, g->width);
+    out_u32(out, g->height);
+    out_u32(out, g->players_num);
+    out_u32(out, g->areas);
+
+    uint64_t acc = 0;
+    uint32_t used = 0;
+    for (uint32_t x = 0; x < g->width; x++) {
+        size_t f = field(g, x, 0);
+        for (uint32_t y = 0; y < g->height; y++, f = up(g, f)) {
+            acc |= (uint64_t) g->board[f].player << used;
+            used += bits;
+            while (used >= 8) {
+                out->data[out->size++] = (uint8_t) acc;
+                acc >>= 8;
+                used -= 8;
+            }
+        }
+    }
+    if (used) { out->data[out->size++] = (uint8_t) acc; }
+    return true;
+}
+
+#ifdef GAME_ZSTD
+/** @brief export_zstd.
+ * Compresses GAME_FORMAT_PACKED into one zstd frame
+ * @param[in] g - pointer to game structure
+ * @param[in,out] out - buffer
+ * @return @p true on success and @p false with @p errno set otherwise
+*/
+static bool export_zstd(game_t const *g, out_buf_t *out) {
+    out_buf_t packed = { NULL, 0, 0 };
+    if (!export_packed(g, &packed)) { free(packed.data); errno = ENOMEM; return false; }
+
+    size_t bound = ZSTD_compressBound(packed.size);
+    bool ok = out_reserve(out, bound);
+    if (ok) {
+        size_t n = ZSTD_compress(out->data, bound, packed.data, packed.size, 3);
+        ok = !ZSTD_isError(n);
+        if (ok) { out->size = n; }
+    }
+    free(packed.data);
+    if (!ok) { errno = ENOMEM; }
+    return ok;
+}
+#endif
+
+void * game_export(game_t const *g, game_format_t format, size_t *size) {
+    if (g == NULL || size == NULL) { errno = EINVAL; return NULL; }
+
+    out_buf_t out = { NULL, 0, 0 };
+    bool ok;
+    switch (format) {
+        case GAME_FORMAT_RLE:
+            ok = export_rle(g, &out);
+            if (!ok) { errno = ENOMEM; }
+            break;
+        case GAME_FORMAT_PACKED:
+            ok = export_packed(g, &out);
+            if (!ok) { errno = ENOMEM; }
+            break;
+        case GAME_FORMAT_ZSTD:
+#ifdef GAME_ZSTD
+            ok = export_zstd(g, &out);
+#else
+            ok = false;
+            errno = ENOTSUP;
+#endif
+            break;
+        default:
+            ok = false;
+            errno = EINVAL;
+    }
+
+    if (!ok) {
+        free(out.data);
+        return NULL;
+    }
+    *size = out.size;
+    return out.data;
+}
+
+/** @brief Part of an area lying in one strip of @ref game_rebuild
+ * info - size and bounding box of the part, perimeter is not used
+ * player - owner of the part
+*/
+struct part {
+    game_area_t info;
+    uint32_t player;
+};
+typedef struct part part_t;
+
+/** @brief Strip of BAND_COLUMNS columns labeled by one task
+ * parts - parts found in the strip, their local labels are
+ *         the indices plus one
+ * count - number of parts
+ * first - global label of the first part
+ * failed - the task could not allocate memory
+*/
+struct strip {
+    part_t * parts;
+    size_t count;
+    size_t first;
+    bool failed;
+};
+typedef struct strip strip_t;
+
+/** @brief Work of @ref game_rebuild
+ * g - pointer to game structure
+ * strips - one element per task
+ * labels - union-find parents of global labels, later ids of areas
+*/
+struct rebuild_job {
+    game_t * g;
+    strip_t * strips;
+    uint32_t * labels;
+};
+typedef struct rebuild_job rebuild_job_t;
+
+/** @brief label_strip.
+ * Task of @ref game_rebuild, labels connected parts of areas
+ * inside one strip with local labels kept in parent_id
+ * @param[in] arg - the rebuild_job_t
+ * @param[in] task - number of the strip
+*/
+static void label_strip(void *arg, uint32_t task) {
+    rebuild_job_t const * job = (rebuild_job_t const *) arg;
+    game_t * g = job->g;
+    strip_t * s = &job->strips[task];
+    uint32_t x0 = task * BAND_COLUMNS;
+    uint32_t x1 = g->width - x0 < BAND_COLUMNS ? g->width : x0 + BAND_COLUMNS;
+
+    for (uint32_t x = x0; x < x1; x++) {
+        size_t c = field(g, x, 0);
+        for (uint32_t y = 0; y < g->height; y++, c = up(g, c)) {
+            g->board[c].parent_id = 0;
+        }
+    }
+
+    size_t cap = 1024;
+    size_t top = 0;
+    size_t parts_cap = 0;
+    pending_t * stack = (pending_t *) malloc(cap * sizeof(pending_t));
+    if (stack == NULL) { s->failed = true; return; }
+
+    for (uint32_t x = x0; x < x1; x++) {
+        size_t c = field(g, x, 0);
+        for (uint32_t y = 0; y < g->height; y++, c = up(g, c)) {
+            uint32_t player = g->board[c].player;
+            if (player == 0 || g->board[c].parent_id) { continue; }
+
+            // local labels have to fit in parent_id
+            if (s->count == UINT32_MAX) { s->failed = true; free(stack); return; }
+            if (s->count == parts_cap) {
+                size_t bigger_cap = parts_cap ? 2 * parts_cap : 64;
+                part_t * bigger = (part_t *) realloc(s->parts,
+                                                     bigger_cap * sizeof(part_t));
+                if (bigger == NULL) { s->failed = true; free(stack); return; }
+                s->parts = bigger;
+                parts_cap = bigger_cap;
+            }
+            part_t * part = &s->parts[s->count++];
+            part->player = player;
+            part->info = (game_area_t) { 0, 0, x, y, x, y };
+            game_area_t * a = &part->info;
+            uint32_t label = (uint32_t) s->count;
+
+            g->board[c].parent_id = label;
+            stack[top++] = (pending_t) { c, x, y };
+            while (top) {
+                pending_t f = stack[--top];
+                a->size++;
+                if (f.x < a->min_x) { a->min_x = f.x; }
+                if (f.y < a->min_y) { a->min_y = f.y; }
+                if (f.x > a->max_x) { a->max_x = f.x; }
+                if (f.y > a->max_y) { a->max_y = f.y; }
+
+                const pending_t next[4] = {
+                    { left(g, f.c), f.x - 1, f.y }, { right(g, f.c), f.x + 1, f.y },
+                    { down(g, f.c), f.x, f.y - 1 }, { up(g, f.c), f.x, f.y + 1 }
+                };
+                for (int i = 0; i < 4; i++) {
+                    // fields of other strips are written by other tasks,
+                    // so they are not even read
+                    if (next[i].x < x0 || next[i].x >= x1) { continue; }
+                    pair_t * n = &g->board[next[i].c];
+                    if (n->player != player || n->parent_id) { continue; }
+                    if (top == cap) {
+                        pending_t * bigger = (pending_t *) realloc(stack,
+                                                 2 * cap * sizeof(pending_t));
+                        if (bigger == NULL) { s->failed = true; free(stack); return; }
+                        stack = bigger;
+                        cap *= 2;
+                    }
+                    n->parent_id = label;
+                    stack[top++] = next[i];
+                }
+            }
+        }
+    }
+    free(stack);
+}
+
+/** @brief find_label.
+ * Finds the representative of a global label, halving the path
+ * @param[in,out] labels - union-find parents
+ * @param[in] l - the label
+ * @return representative of @p l, the smallest label of its set
+*/
+static inline uint32_t find_label(uint32_t *labels, uint32_t l) {
+    while (labels[l] != l) {
+        labels[l] = labels[labels[l]];
+        l = labels[l];
+    }
+    return l;
+}
+
+/** @brief join_strips.
+ * Joins sets of parts that touch across the border
+ * between strip @p s and the next one
+ * @param[in,out] job - the rebuild_job_t
+ * @param[in] s - number of the strip
+*/
+static void join_strips(rebuild_job_t *job, uint32_t s) {
+    game_t * g = job->g;
+    uint32_t x = (s + 1) * BAND_COLUMNS;
+    size_t a = field(g, x - 1, 0);
+    size_t b = field(g, x, 0);
+    size_t first_a = job->strips[s].first - 1;
+    size_t first_b = job->strips[s + 1].first - 1;
+
+    for (uint32_t y = 0; y < g->height; y++, a = up(g, a), b = up(g, b)) {
+        uint32_t player = g->board[a].player;
+        if (player == 0 || player != g->board[b].player) { continue; }
+        uint32_t ra = find_label(job->labels,
+                                 (uint32_t) (first_a + g->board[a].parent_id));
+        uint32_t rb = find_label(job->labels,
+                                 (uint32_t) (first_b + g->board[b].parent_id));
+        // the smaller label is the representative
+        if (ra < rb) { job->labels[rb] = ra; }
+        else if (rb < ra) { job->labels[ra] = rb; }
+    }
+}
+
+/** @brief relabel_strip.
+ * Task of @ref game_rebuild, replaces local labels of a strip
+ * with ids of the areas
+ * @param[in] arg - the rebuild_job_t
+ * @param[in] task - number of the strip
+*/
+static void relabel_strip(void *arg, uint32_t task) {
+    rebuild_job_t const * job = (rebuild_job_t const *) arg;
+    game_t * g = job->g;
+    uint32_t const * ids = job->labels + job->strips[task].first - 1;
+    uint32_t x0 = task * BAND_COLUMNS;
+    uint32_t x1 = g->width - x0 < BAND_COLUMNS ? g->width : x0 + BAND_COLUMNS;
+
+    for (uint32_t x = x0; x < x1; x++) {
+        size_t c = field(g, x, 0);
+        for (uint32_t y = 0; y < g->height; y++, c = up(g, c)) {
+            if (g->board[c].player != 0) {
+                g->board[c].parent_id = ids[g->board[c].parent_id];
+            }
+        }
+    }
+}
+
+/** @brief make_areas.
+ * Creates an area for every set of parts and turns
+ * the union-find parents into ids of the areas
+ * @param[in,out] job - the rebuild_job_t
+ * @param[in] strips - number of strips
+ * @return @p true on success, @p false with @p errno set to EINVAL
+ * if a player has more areas than the limit
+*/
+static bool make_areas(rebuild_job_t *job, uint32_t strips) {
+    game_t * g = job->g;
+    uint32_t * labels = job->labels;
+    uint32_t l = 1;
+
+    for (uint32_t s = 0; s < strips; s++) {
+        part_t const * parts = job->strips[s].parts;
+        for (size_t i = 0; i < job->strips[s].count; i++, l++) {
+            uint32_t player = parts[i].player;
+            game_area_t const * part = &parts[i].info;
+            uint32_t id;
+            if (labels[l] == l) {
+                player_t * p = &g->players[player - 1];
+                if (p->busy_areas == g->areas) { errno = EINVAL; return false; }
+                if (!reserve_area(g)) { return false; }
+                id = new_area(g, player, part->min_x, part->min_y);
+                p->busy_areas++;
+            } else {
+                // representatives come first, so they already hold ids
+                id = labels[labels[l]];
+            }
+            labels[l] = id;
+
+            game_area_t * a = &g->area_list[id].info;
+            a->size += part->size;
+            if (part->min_x < a->min_x) { a->min_x = part->min_x; }
+            if (part->min_y < a->min_y) { a->min_y = part->min_y; }
+            if (part->max_x > a->max_x) { a->max_x = part->max_x; }
+            if (part->max_y > a->max_y) { a->max_y = part->max_y; }
+            g->players[player - 1].completed_moves += part->size;
+        }
+    }
+    return true;
+}
+
+bool game_rebuild(game_t *g, game_pool_t *pool) {
+    if (g == NULL || g->players == NULL) { errno = EINVAL; return false; }
+
+    uint32_t strips = (g->width - 1) / BAND_COLUMNS + 1;
+    rebuild_job_t job = { g, (strip_t *) calloc(strips, sizeof(strip_t)), NULL };
+    if (job.strips == NULL) { errno = ENOMEM; return false; }
+    game_pool_run(pool, strips, label_strip, &job);
+
+    bool ok = true;
+    size_t labels = 1;
+    for (uint32_t s = 0; s < strips; s++) {
+        job.strips[s].first = labels;
+        labels += job.strips[s].count;
+        if (job.strips[s].failed) { ok = false; }
+    }
+    // label 0 is unused, labels are uint32_t like ids of areas
+    if (ok && labels > UINT32_MAX) { ok = false; }
+    if (ok) {
+        job.labels = (uint32_t *) malloc(labels * sizeof(uint32_t));
+        ok = job.labels != NULL;
+    }
+    if (!ok) { errno = ENOMEM; }
+
+    if (ok) {
+        for (size_t l = 0; l < labels; l++) { job.labels[l] = (uint32_t) l; }
+        for (uint32_t s = 0; s + 1 < strips; s++) { join_strips(&job, s); }
+        // parts are turned into areas counted from scratch
+        memset(g->players, 0, g->players_num * sizeof(player_t));
+        g->area_top = 1;
+        g->free_area = 0;
+        ok = make_areas(&job, strips);
+    }
+    if (ok) {
+        game_pool_run(pool, strips, relabel_strip, &job);
+        recount(g, pool);
+    }
+
+    for (uint32_t s = 0; s < strips; s++) { free(job.strips[s].parts); }
+    free(job.strips);
+    free(job.labels);
+    return ok;
+}
+
+/** @brief import_finish.
+ * Rebuilds counters of the imported board
+ * @param[in,out] g - pointer to game structure or NULL
+ * @return @p g or NULL with @p errno set if the board is not valid
+*/
+static game_t * import_finish(game_t *g) {
+    if (g == NULL) { return NULL; }
+    if (!game_rebuild(g, NULL)) {
+        int err = errno;
+        game_delete(g);
+        errno = err;
+        return NULL;
+    }
+    return g;
+}
+
+/** @brief import_fail.
+ * @param[in] g - pointer to game structure
+ * @return NULL with @p errno set to EINVAL
+*/
+static game_t * import_fail(game_t *g) {
+    game_delete(g);
+    errno = EINVAL;
+    return NULL;
+}
+
+/** @brief import_new.
+ * Creates the game of an importer
+ * @param[in] dims - width, height, players and areas
+ * @return the game or NULL with @p errno set
+*/
+static game_t * import_new(uint32_t const *dims) {
+    errno = 0;
+    game_t * g = game_new(dims[0], dims[1], dims[2], dims[3]);
+    if (g == NULL && errno != ENOMEM) { errno = EINVAL; }
+    return g;
+}
+
+/** @brief parse_number.
+ * Reads a decimal number
+ * @param[in,out] p - position in the data
+ * @param[in] end - end of the data
+ * @param[out] value - the number
+ * @return @p true if a number not greater than UINT32_MAX was read
+*/
+static bool parse_number(uint8_t const **p, uint8_t const *end, uint32_t *value) {
+    uint64_t v = 0;
+    uint8_t const * start = *p;
+    while (*p < end && **p >= '0' && **p <= '9') {
+        v = v * 10 + (uint64_t) (**p - '0');
+        if (v > UINT32_MAX) { return false; }
+        (*p)++;
+    }
+    *value = (uint32_t) v;
+    return *p != start;
+}
+
+/** @brief import_rle.
+ * @param[in] data - GAME_FORMAT_RLE
+ * @param[in] size - length of the data
+ * @return rebuilt game or NULL with @p errno set
+*/
+static game_t * import_rle(uint8_t const *data, size_t size) {
+    uint8_t const * p = data + 5;
+    uint8_t const * end = data + size;
+    uint32_t dims[4];
+    for (int i = 0; i < 4; i++) {
+        if (i && (p == end || *p++ != ' ')) { errno = EINVAL; return NULL; }
+        if (!parse_number(&p, end, &dims[i])) { errno = EINVAL; return NULL; }
+    }
+    if (p == end || *p++ != '\n' || dims[0] > (size_t) (end - p)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    game_t * g = import_new(dims);
+    if (g == NULL) { return NULL; }
+
+    for (uint32_t x = 0; x < g->width; x++) {
+        size_t f = field(g, x, 0);
+        uint32_t y = 0;
+        while (p < end && *p != '\n') {
+            uint32_t run = 1;
+            if (*p >= '0' && *p <= '9' && (!parse_number(&p, end, &run) || run < 2)) {
+                return import_fail(g);
+            }
+            if (p == end) { return import_fail(g); }
+            uint32_t player = rle_player(*p++);
+            if (player != 0 && player > g->players_num) { return import_fail(g); }
+            if (run > g->height - y) { return import_fail(g); }
+            for (uint32_t k = 0; k < run; k++, f = up(g, f)) {
+                g->board[f].player = player;
+                if (player) {
+                    mark_dirty(g, f);
+                    g->taken++;
+                }
+            }
+            y += run;
+        }
+        if (p == end || y != g->height) { return import_fail(g); }
+        p++;
+    }
+    if (p != end) { return import_fail(g); }
+    return import_finish(g);
+}
+
+/** @brief import_packed.
+ * @param[in] data - GAME_FORMAT_PACKED
+ * @param[in] size - length of the data
+ * @return rebuilt game or NULL with @p errno set
+*/
+static game_t * import_packed(uint8_t const *data, size_t size) {
+    if (size < 20) { errno = EINVAL; return NULL; }
+    uint32_t dims[4];
+    for (int i = 0; i < 4; i++) { dims[i] = in_u32(data + 4 + 4 * i); }
+
+    // the length is checked before the board is allocated
+    uint32_t bits = packed_bits(dims[2]);
+    uint64_t cells = (uint64_t) dims[0] * dims[1];
+    if (dims[2] > MAX_PLAYERS || (cells * bits + 7) / 8 != size - 20) {
+        errno = EINVAL;
+        return NULL;
+    }
+    game_t * g = import_new(dims);
+    if (g == NULL) { return NULL; }
+
+    uint8_t const * p = data + 20;
+    uint64_t acc = 0;
+    uint32_t have = 0;
+    for (uint32_t x = 0; x < g->width; x++) {
+        size_t f = field(g, x, 0);
+        for (uint32_t y = 0; y < g->height; y++, f = up(g, f)) {
+            while (have < bits) {
+                acc |= (uint64_t) *p++ << have;
+                have += 8;
+            }
+            uint32_t player = (uint32_t) (acc & ((1u << bits) - 1));
+            acc >>= bits;
+            have -= bits;
+            if (player > g->players_num) { return import_fail(g); }
+            g->board[f].player = player;
+            if (player) {
+                mark_dirty(g, f);
+                g->taken++;
+            }
+        }
+    }
+    return import_finish(g);
+}
+
+game_t * game_import(void const *data, size_t size) {
+    uint8_t const * bytes = (uint8_t const *) data;
+    if (bytes == NULL || size < 4) { errno = EINVAL; return NULL; }
+
+    if (size >= 5 && memcmp(bytes, "GAME ", 5) == 0) { return import_rle(bytes, size); }
+    if (memcmp(bytes, "GPK1", 4) == 0) { return import_packed(bytes, size); }
+    if (in_u32(bytes) == 0xFD2FB528u) {
+#ifdef GAME_ZSTD
+        unsigned long long n = ZSTD_getFrameContentSize(bytes, size);
+        if (n == ZSTD_CONTENTSIZE_UNKNOWN || n == ZSTD_CONTENTSIZE_ERROR || n > SIZE_MAX) {
+            errno = EINVAL;
+            return NULL;
+        }
+        uint8_t * packed = (uint8_t *) malloc(n ? (size_t) n : 1);
+        if (packed == NULL) { errno = ENOMEM; return NULL; }
+        size_t got = ZSTD_decompress(packed, (size_t) n, bytes, size);
+        game_t * g = NULL;
+        if (ZSTD_isError(got) || got != n || got < 4 || memcmp(packed, "GPK1", 4) != 0) {
+            errno = EINVAL;
+        } else {
+            g = import_packed(packed, got);
+        }
+        int err = errno;
+        free(packed);
+        errno = err;
+        return g;
+#else
+        errno = ENOTSUP;
+        return NULL;
+#endif
+    }
+    errno = EINVAL;
+    return NULL;
+}
+
+bool game_stats(game_t const *g, game_stats_t *out) {
+    if (out == NULL) { return false; }
+#ifdef GAME_STATS
+    if (g != NULL) {
+        memcpy(out, &g->stats, sizeof(game_stats_t));
+        return true;
     }
+#else
+    (void) g;
+#endif
+    memset(out, 0, sizeof(game_stats_t));
+    return false;
 }
\ No newline at end of file
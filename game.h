@@ -14,6 +14,11 @@
 #include <stdio.h>
 #include <errno.h>
 #include <stdlib.h>
+#include "game_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * To jest deklaracja struktury przechowującej stan gry.
@@ -35,13 +40,147 @@ typedef struct game game_t;
 game_t* game_new(uint32_t width, uint32_t height,
                  uint32_t players, uint32_t areas);
 
+/** @brief Podaje rozmiar pamięci potrzebnej na stan gry.
+ * Cały stan gry, łącznie z planszą i opisami obszarów, zajmuje jeden blok
+ * pamięci, którego rozmiar zależy tylko od parametrów gry. Tyle pamięci
+ * alokuje funkcja @ref game_new i tyle wymaga funkcja @ref game_new_in.
+ * @param[in] width   – szerokość planszy, liczba dodatnia,
+ * @param[in] height  – wysokość planszy, liczba dodatnia,
+ * @param[in] players – liczba graczy, liczba dodatnia,
+ * @param[in] areas   – maksymalna liczba obszarów, które może zająć jeden
+ *                      gracz, liczba dodatnia.
+ * @return Liczba bajtów lub zero, gdy któryś z parametrów jest niepoprawny.
+ */
+size_t game_footprint(uint32_t width, uint32_t height,
+                      uint32_t players, uint32_t areas);
+
+/** @brief Tworzy strukturę przechowującą stan gry w podanej pamięci.
+ * Działa jak funkcja @ref game_new, ale umieszcza cały stan gry w bloku
+ * @p memory, który należy do wywołującego i może być używany wielokrotnie,
+ * np. z puli bloków. Blok nie może być używany przez inną grę, dopóki gra
+ * trwa. Gdy blok jest za mały, ustawia @p errno na @p ENOMEM.
+ * @param[in] memory  – blok pamięci,
+ * @param[in] size    – rozmiar bloku, co najmniej @ref game_footprint,
+ * @param[in] width   – szerokość planszy, liczba dodatnia,
+ * @param[in] height  – wysokość planszy, liczba dodatnia,
+ * @param[in] players – liczba graczy, liczba dodatnia,
+ * @param[in] areas   – maksymalna liczba obszarów, które może zająć jeden
+ *                      gracz, liczba dodatnia.
+ * @return Wskaźnik na utworzoną strukturę, leżącą wewnątrz bloku, lub NULL,
+ * gdy blok jest za mały lub któryś z parametrów jest niepoprawny.
+ */
+game_t* game_new_in(void *memory, size_t size, uint32_t width, uint32_t height,
+                    uint32_t players, uint32_t areas);
+
+/**
+ * Rodzaje stron pamięci gry tworzonej funkcją @ref game_new_ex.
+ */
+typedef enum game_pages {
+  GAME_PAGES_DEFAULT,     ///< pamięć z funkcji calloc, jak w @ref game_new
+  GAME_PAGES_TRANSPARENT, ///< strony 4 KiB z prośbą o przezroczyste duże
+                          ///< strony (madvise MADV_HUGEPAGE)
+  GAME_PAGES_HUGE         ///< jawne duże strony (MAP_HUGETLB), muszą być
+                          ///< zarezerwowane w systemie
+} game_pages_t;
+
+/**
+ * Rozmieszczenie pamięci gry w węzłach NUMA.
+ */
+typedef enum game_numa {
+  GAME_NUMA_DEFAULT,   ///< zgodnie z polityką procesu
+  GAME_NUMA_BIND,      ///< tylko w węzłach z maski @p nodes
+  GAME_NUMA_INTERLEAVE ///< stronami na przemian w węzłach z maski @p nodes
+} game_numa_t;
+
+/**
+ * To jest struktura z parametrami funkcji @ref game_new_ex.
+ */
+typedef struct game_options {
+  uint32_t width;     ///< szerokość planszy, jak w @ref game_new
+  uint32_t height;    ///< wysokość planszy
+  uint32_t players;   ///< liczba graczy
+  uint32_t areas;     ///< maksymalna liczba obszarów jednego gracza
+  game_pages_t pages; ///< rodzaj stron pamięci
+  game_numa_t numa;   ///< rozmieszczenie w węzłach NUMA
+  uint64_t nodes;     ///< maska węzłów NUMA, bit i oznacza węzeł i
+} game_options_t;
+
+/** @brief Tworzy strukturę przechowującą stan gry z opcjami alokacji.
+ * Działa jak funkcja @ref game_new z parametrami z @p options. Gdy opcje
+ * stron lub NUMA są inne niż domyślne, cały stan gry leży w pamięci
+ * mapowanej funkcją mmap, zaokrąglonej do 2 MiB. Dostępne tylko w systemie
+ * Linux. W przypadku błędu systemu (np. braku zarezerwowanych dużych
+ * stron) ustawia @p errno na wartość przez niego zgłoszoną.
+ * @param[in] options – wskaźnik na parametry gry.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ * przydzielić pamięci lub któryś z parametrów jest niepoprawny.
+ */
+game_t* game_new_ex(game_options_t const *options);
+
 /** @brief Usuwa strukturę przechowującą stan gry.
- * Usuwa z pamięci strukturę wskazywaną przez @p g.
+ * Usuwa z pamięci strukturę wskazywaną przez @p g. Pamięci gry utworzonej
+ * funkcją @ref game_new_in nie zwalnia, bo należy ona do wywołującego.
  * Nic nie robi, jeśli wskaźnik ten ma wartość NULL.
  * @param[in] g       – wskaźnik na usuwaną strukturę.
  */
 void game_delete(game_t *g);
 
+/** @brief Przywraca początkowy stan gry.
+ * Ustawia grę @p g w stanie, w jakim utworzyła ją funkcja @ref game_new,
+ * z tymi samymi parametrami. Czyści tylko 64-polowe bloki planszy,
+ * w których zajęto pola, więc czas działania jest proporcjonalny do liczby
+ * wykonanych ruchów, a nie do rozmiaru planszy.
+ * Nic nie robi, jeśli wskaźnik @p g ma wartość NULL.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ */
+void game_reset(game_t *g);
+
+/**
+ * To jest deklaracja struktury przechowującej gry do ponownego użycia.
+ * Gry są grupowane według parametrów funkcji @ref game_new. Struktura nie
+ * jest zabezpieczona przed jednoczesnym użyciem przez kilka wątków.
+ */
+typedef struct game_cache game_cache_t;
+
+/** @brief Tworzy pustą strukturę gier do ponownego użycia.
+ * Gdy nie udało się alokować pamięci, ustawia @p errno na @p ENOMEM.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+game_cache_t* game_cache_new(void);
+
+/** @brief Usuwa strukturę gier do ponownego użycia.
+ * Usuwa też wszystkie przechowywane w niej gry. Nic nie robi, jeśli
+ * wskaźnik @p cache ma wartość NULL.
+ * @param[in] cache   – wskaźnik na usuwaną strukturę.
+ */
+void game_cache_delete(game_cache_t *cache);
+
+/** @brief Daje grę w stanie początkowym.
+ * Zwraca przechowywaną grę o podanych parametrach, a gdy takiej nie ma,
+ * tworzy nową funkcją @ref game_new.
+ * @param[in,out] cache – wskaźnik na strukturę gier lub NULL,
+ * @param[in] width   – szerokość planszy, liczba dodatnia,
+ * @param[in] height  – wysokość planszy, liczba dodatnia,
+ * @param[in] players – liczba graczy, liczba dodatnia,
+ * @param[in] areas   – maksymalna liczba obszarów, które może zająć jeden
+ *                      gracz, liczba dodatnia.
+ * @return Wskaźnik na strukturę przechowującą stan gry lub NULL, gdy
+ * nie udało się alokować pamięci lub któryś z parametrów jest niepoprawny.
+ */
+game_t* game_cache_get(game_cache_t *cache, uint32_t width, uint32_t height,
+                       uint32_t players, uint32_t areas);
+
+/** @brief Oddaje grę do ponownego użycia.
+ * Przywraca początkowy stan gry funkcją @ref game_reset i przechowuje ją
+ * w strukturze @p cache. Gdy gier o tych parametrach jest już dużo, gdy
+ * @p cache ma wartość NULL lub gra pochodzi z @ref game_new_in, usuwa ją
+ * funkcją @ref game_delete. Po wywołaniu nie wolno używać wskaźnika @p g.
+ * @param[in,out] cache – wskaźnik na strukturę gier lub NULL,
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
+ */
+void game_cache_put(game_cache_t *cache, game_t *g);
+
 /** @brief Wykonuje ruch.
  * Ustawia pionek gracza @p player na polu (@p x, @p y).
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
@@ -57,6 +196,100 @@ void game_delete(game_t *g);
  */
 bool game_move(game_t *g, uint32_t player, uint32_t x, uint32_t y);
 
+/**
+ * To są wyniki funkcji @ref game_move_ex.
+ */
+typedef enum game_move_result {
+  GAME_MOVE_OK,       ///< ruch został wykonany
+  GAME_MOVE_NO_GAME,  ///< wskaźnik na strukturę gry ma wartość NULL
+  GAME_MOVE_PLAYER,   ///< niepoprawny numer gracza
+  GAME_MOVE_RANGE,    ///< pole spoza planszy
+  GAME_MOVE_OCCUPIED, ///< pole jest zajęte
+  GAME_MOVE_AREAS,    ///< ruch przekroczyłby limit obszarów gracza
+  GAME_MOVE_MEMORY,   ///< nie udało się alokować pamięci
+  GAME_MOVE_RESULTS   ///< liczba wyników
+} game_move_result_t;
+
+/**
+ * To jest struktura opisująca zmiany liczników wykonane przez ruch.
+ */
+typedef struct game_move_info {
+  int64_t boundary;   ///< zmiana liczby wolnych pól wokół obszarów gracza
+  int32_t areas;      ///< zmiana liczby obszarów gracza
+  uint32_t merged;    ///< liczba obszarów dołączonych do innego obszaru
+  uint32_t strangers; ///< liczba innych graczy, którym ubyło wolne pole
+} game_move_info_t;
+
+/** @brief Wykonuje ruch i podaje jego wynik.
+ * Działa tak jak funkcja @ref game_move, ale podaje przyczynę odrzucenia
+ * ruchu. Jeśli ruch został wykonany, a wskaźnik @p info nie ma wartości NULL,
+ * zapisuje w @p info zmiany liczników, które spowodował ruch. Pozostałym
+ * graczom, których pola sąsiadują z polem (@p x, @p y), liczba wolnych pól
+ * wokół obszarów zmniejsza się o jeden.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref game_new,
+ * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
+ *                      @p width z funkcji @ref game_new,
+ * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
+ *                      @p height z funkcji @ref game_new,
+ * @param[out] info   – wskaźnik na strukturę na zmiany liczników lub NULL.
+ * @return Wartość @ref GAME_MOVE_OK, jeśli ruch został wykonany, a w przeciwnym
+ * przypadku przyczyna odrzucenia ruchu.
+ */
+game_move_result_t game_move_ex(game_t *g, uint32_t player,
+                                uint32_t x, uint32_t y, game_move_info_t *info);
+
+/**
+ * Sposoby liczenia wolnych pól wokół obszarów graczy.
+ */
+typedef enum game_boundary {
+  GAME_BOUNDARY_EXACT,   ///< liczniki są poprawiane po każdym ruchu
+  GAME_BOUNDARY_DEFERRED ///< liczniki są liczone od nowa przy pierwszym
+                         ///< zapytaniu po ruchach
+} game_boundary_t;
+
+/** @brief Wybiera sposób liczenia wolnych pól wokół obszarów.
+ * W trybie @ref GAME_BOUNDARY_DEFERRED ruchy nie poprawiają liczby wolnych
+ * pól wokół obszarów graczy ani obwodów obszarów, co przyspiesza odtwarzanie
+ * długich zapisów gier. Oba liczniki są liczone od nowa, jednym przejściem
+ * po planszy, przy pierwszym wywołaniu funkcji @ref game_free_fields lub
+ * @ref game_areas po ruchach. Funkcje @ref game_is_over,
+ * @ref game_next_player_with_moves, @ref game_current_player,
+ * @ref game_play i @ref game_pass liczą je od nowa tylko wtedy, gdy
+ * któryś z graczy zajął już @p areas obszarów. Przejście wykonują wątki
+ * puli @p pool, jeśli nie ma ona wartości NULL. Wyniki zapytań są takie
+ * same w obu trybach, ale w trybie odroczonym dwa zapytania o tę samą grę
+ * nie mogą być wykonywane jednocześnie. Przejście do trybu
+ * @ref GAME_BOUNDARY_EXACT od razu przelicza liczniki. Funkcja
+ * @ref game_reset przywraca tryb @ref GAME_BOUNDARY_EXACT.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] mode    – sposób liczenia,
+ * @param[in] pool    – pula wątków do przeliczania liczników lub NULL;
+ *                      musi istnieć, dopóki gra jest w trybie odroczonym.
+ * @return Wartość @p true, jeśli tryb został ustawiony, a @p false,
+ * jeśli wskaźnik @p g ma wartość NULL lub tryb jest niepoprawny.
+ */
+bool game_set_boundary(game_t *g, game_boundary_t mode, game_pool_t *pool);
+
+/**
+ * Liczba ostatnich ruchów, które może cofnąć funkcja @ref game_undo.
+ */
+#define GAME_UNDO_MOVES 4096
+
+/** @brief Cofa ostatni ruch.
+ * Zdejmuje z planszy pionek postawiony ostatnim wykonanym ruchem
+ * i przywraca stan gry sprzed tego ruchu. Obszar podzielony przez
+ * zdjęcie pionka jest dzielony na części, więc czas działania jest
+ * proporcjonalny do rozmiaru obszaru. Kolejne wywołania cofają kolejne
+ * ruchy, najwyżej @ref GAME_UNDO_MOVES ostatnich. Pól odtworzonych funkcją
+ * @ref game_import nie cofa.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wartość @p true, jeśli ruch został cofnięty, a @p false,
+ * jeśli nie ma ruchu do cofnięcia lub wskaźnik @p g ma wartość NULL.
+ */
+bool game_undo(game_t *g);
+
 /** @brief Podaje liczbę pól zajętych przez gracza.
  * Podaje liczbę pól zajętych przez gracza @p player.
  * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
@@ -78,6 +311,172 @@ uint64_t game_busy_fields(game_t const *g, uint32_t player);
  */
 uint64_t game_free_fields(game_t const *g, uint32_t player);
 
+/** @brief Sprawdza, czy gra się skończyła.
+ * Gra kończy się, gdy żaden gracz nie może wykonać ruchu. Silnik pamięta
+ * liczbę graczy, którzy nie mają ruchu, więc czas działania nie zależy
+ * od rozmiaru planszy. W trybie @ref GAME_BOUNDARY_DEFERRED pierwsze
+ * zapytanie po ruchach przelicza liczniki jak @ref game_free_fields.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wartość @p true, jeśli żaden gracz nie ma ruchu, a @p false
+ * w przeciwnym przypadku lub gdy wskaźnik @p g ma wartość NULL.
+ */
+bool game_is_over(game_t const *g);
+
+/** @brief Podaje następnego gracza, który ma ruch.
+ * Szuka gracza mającego legalny ruch wśród graczy @p from + 1, …,
+ * @p players, 1, …, @p from, w tej kolejności. Czas działania jest
+ * proporcjonalny do liczby graczy.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] from    – numer gracza, od którego zaczyna się szukanie,
+ *                      liczba nieujemna niewiększa od wartości @p players
+ *                      z funkcji @ref game_new; zero oznacza szukanie
+ *                      od gracza 1.
+ * @return Numer znalezionego gracza lub zero, jeśli gra się skończyła,
+ * parametr jest niepoprawny lub wskaźnik @p g ma wartość NULL.
+ */
+uint32_t game_next_player_with_moves(game_t const *g, uint32_t from);
+
+/** @brief Podaje wyniki graczy.
+ * Zapisuje w @p scores liczby pól zajętych przez kolejnych graczy,
+ * wynik gracza @p p na pozycji @p p - 1.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[out] scores – bufor na co najmniej @p players liczb, gdzie
+ *                      @p players to wartość z funkcji @ref game_new.
+ * @return Wartość @p true, jeśli wyniki zostały zapisane, a @p false,
+ * jeśli któryś ze wskaźników ma wartość NULL.
+ */
+bool game_scores(game_t const *g, uint64_t *scores);
+
+/** @brief Podaje gracza, na którego przypada kolej.
+ * Gra pamięta gracza, na którego przypada kolej w funkcji @ref game_play;
+ * na początku gry i po wywołaniu @ref game_reset jest to gracz 1. Jeśli
+ * ten gracz nie ma ruchu, kolej przechodzi na następnego gracza, który ma
+ * ruch, tak jak w funkcji @ref game_next_player_with_moves. Ruchy wykonane
+ * funkcją @ref game_move nie zmieniają kolejki.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
+ * @return Numer gracza, na którego przypada kolej, lub zero, jeśli gra się
+ * skończyła lub wskaźnik @p g ma wartość NULL.
+ */
+uint32_t game_current_player(game_t const *g);
+
+/** @brief Wykonuje ruch gracza, na którego przypada kolej.
+ * Stawia pionek gracza podanego przez @ref game_current_player na polu
+ * (@p x, @p y) i przekazuje kolej następnemu graczowi. Gracze bez ruchu są
+ * pomijani, więc pętla rozgrywki wymaga jednego wywołania na ruch. Funkcja
+ * @ref game_undo przywraca kolej sprzed cofniętego ruchu.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
+ *                      @p width z funkcji @ref game_new,
+ * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
+ *                      @p height z funkcji @ref game_new.
+ * @return Wartość @p true, jeśli ruch został wykonany, a @p false, jeśli
+ * ruch jest nielegalny, gra się skończyła lub wskaźnik @p g ma wartość NULL.
+ */
+bool game_play(game_t *g, uint32_t x, uint32_t y);
+
+/** @brief Oddaje kolej bez ruchu.
+ * Przekazuje kolej graczowi następnemu po graczu podanym przez
+ * @ref game_current_player.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wartość @p true, jeśli kolej została przekazana, a @p false,
+ * jeśli gra się skończyła lub wskaźnik @p g ma wartość NULL.
+ */
+bool game_pass(game_t *g);
+
+/** @brief Sprawdza, czy ruch jest legalny.
+ * Sprawdza, czy gracz @p player może postawić pionek na polu (@p x, @p y).
+ * Nie zmienia stanu gry.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref game_new,
+ * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
+ *                      @p width z funkcji @ref game_new,
+ * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
+ *                      @p height z funkcji @ref game_new.
+ * @return Wartość @p true, jeśli funkcja @ref game_move wykonałaby ten ruch,
+ * a @p false w przeciwnym przypadku.
+ */
+bool game_can_move(game_t const *g, uint32_t player, uint32_t x, uint32_t y);
+
+/** @brief Wyznacza mapę legalnych ruchów w prostokącie.
+ * Dla każdego pola prostokąta o lewym dolnym rogu (@p x, @p y), szerokości
+ * @p w i wysokości @p h ustawia w mapie @p mask bit, jeśli gracz @p player
+ * może postawić na tym polu pionek. Każdy wiersz prostokąta zajmuje
+ * (@p w + 7) / 8 bajtów, a polu (@p x + i, @p y + j) odpowiada bit
+ * i % 8 bajtu j * ((@p w + 7) / 8) + i / 8. Nie zmienia stanu gry.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref game_new,
+ * @param[in] x       – numer pierwszej kolumny prostokąta,
+ * @param[in] y       – numer pierwszego wiersza prostokąta,
+ * @param[in] w       – szerokość prostokąta, liczba dodatnia,
+ * @param[in] h       – wysokość prostokąta, liczba dodatnia,
+ * @param[out] mask   – bufor na mapę o rozmiarze co najmniej
+ *                      @p h * ((@p w + 7) / 8) bajtów.
+ * @return Liczba legalnych ruchów w prostokącie lub zero, jeśli któryś
+ * z parametrów jest niepoprawny, prostokąt wychodzi poza planszę lub któryś
+ * ze wskaźników ma wartość NULL.
+ */
+uint64_t game_can_move_mask(game_t const *g, uint32_t player,
+                            uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+                            uint8_t *mask);
+
+/**
+ * Kolejność elementów tensora płaszczyzn cech, N to numer gry, C numer
+ * płaszczyzny, H numer wiersza, a W numer kolumny planszy.
+ */
+typedef enum game_layout {
+  GAME_LAYOUT_NCHW, ///< płaszczyzna po płaszczyźnie, w niej wiersz po wierszu
+  GAME_LAYOUT_NHWC  ///< pole po polu, wiersz po wierszu, w polu płaszczyzny
+} game_layout_t;
+
+/**
+ * Typy elementów tensora płaszczyzn cech.
+ */
+typedef enum game_planes_type {
+  GAME_PLANES_U8, ///< uint8_t o wartości 0 lub 1
+  GAME_PLANES_F32 ///< float o wartości 0.0 lub 1.0
+} game_planes_type_t;
+
+/** @brief Zapisuje płaszczyzny cech planszy.
+ * Zapisuje w tensorze @p out 2 * @p players płaszczyzn o wymiarach
+ * @p height na @p width. Płaszczyzna p - 1 ma jedynki na polach gracza p,
+ * a płaszczyzna @p players + p - 1 na polach, na których gracz p może
+ * postawić pionek zgodnie z funkcją @ref game_can_move. Wiersz tensora
+ * o numerze y odpowiada wierszowi y planszy, a kolumna x kolumnie x.
+ * W przypadku błędu ustawia @p errno na @p ENOMEM lub @p EINVAL.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[out] out    – tensor na 2 * @p players * @p height * @p width
+ *                      elementów typu @p type,
+ * @param[in] layout  – kolejność elementów,
+ * @param[in] type    – typ elementów.
+ * @return Wartość @p true, jeśli płaszczyzny zostały zapisane,
+ * a @p false, jeśli któryś z parametrów jest niepoprawny lub zabrakło
+ * pamięci.
+ */
+bool game_feature_planes(game_t const *g, void *out, game_layout_t layout,
+                         game_planes_type_t type);
+
+/** @brief Zapisuje płaszczyzny cech wielu plansz.
+ * Działa tak jak funkcja @ref game_feature_planes dla każdej z gier
+ * @p games, zapisując płaszczyzny gry i na pozycji i tensora @p out.
+ * Wszystkie gry muszą mieć te same wymiary planszy i liczbę graczy.
+ * Gry są rozdzielane między wątki puli @p pool, jeśli nie ma ona
+ * wartości NULL.
+ * @param[in] games   – tablica wskaźników na struktury gier,
+ * @param[in] n       – liczba gier,
+ * @param[out] out    – tensor na @p n * 2 * @p players * @p height * @p width
+ *                      elementów typu @p type,
+ * @param[in] layout  – kolejność elementów,
+ * @param[in] type    – typ elementów,
+ * @param[in] pool    – pula wątków lub NULL.
+ * @return Wartość @p true, jeśli płaszczyzny wszystkich gier zostały
+ * zapisane, a @p false w przeciwnym przypadku.
+ */
+bool game_feature_planes_batch(game_t const * const *games, size_t n, void *out,
+                               game_layout_t layout, game_planes_type_t type,
+                               game_pool_t *pool);
+
 /** Podaje szerokość planszy.
  * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
  * @return Szerokość planszy lub zero, gdy wskaźnik @p g ma wartość NULL.
@@ -117,4 +516,174 @@ char game_player(game_t const *g, uint32_t player);
  */
 char* game_board(game_t const *g);
 
+/** @brief Daje napis opisujący stan planszy, tworząc go równolegle.
+ * Działa jak funkcja @ref game_board, ale dzieli napis na pasy kolejnych
+ * wierszy. Pas zaczyna się w buforze od pozycji (szerokość + 1) * wiersz,
+ * więc wątki puli @p pool wypełniają pasy niezależnie od siebie.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] pool    – pula wątków lub NULL, gdy napis ma powstać w wątku
+ *                      wywołującym.
+ * @return Wskaźnik na alokowany bufor zawierający napis opisujący stan planszy
+ * lub NULL, jeśli nie udało się alokować pamięci.
+ */
+char* game_board_parallel(game_t const *g, game_pool_t *pool);
+
+/** @brief Zapisuje napis opisujący stan planszy do deskryptora pliku.
+ * Zapisuje do @p fd ten sam napis, co funkcja @ref game_board, bez końcowego
+ * znaku zerowego. Napis powstaje w kawałkach w kilku buforach o stałym
+ * rozmiarze, zapisywanych funkcją @p writev, więc zużycie pamięci nie zależy
+ * od rozmiaru planszy. W przypadku błędu ustawia @p errno.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] fd      – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true, jeśli napis został zapisany, a @p false, gdy
+ * wskaźnik @p g ma wartość NULL, nie udało się alokować pamięci lub zapis
+ * się nie powiódł.
+ */
+bool game_board_write(game_t const *g, int fd);
+
+/**
+ * Formaty zapisu planszy funkcji @ref game_export i @ref game_import.
+ * Pola są zapisywane kolumnami, od kolumny 0, a w kolumnie od wiersza 0.
+ */
+typedef enum game_format {
+  /** Tekst: wiersz "GAME szerokość wysokość gracze obszary", a dalej
+   * jeden wiersz na kolumnę planszy z ciągami jednakowych pól. Ciąg to
+   * opcjonalna długość (co najmniej 2) i symbol: '.' dla pustego pola,
+   * 'A'–'Z' dla graczy 1–26 i 'a'–'i' dla graczy 27–35. */
+  GAME_FORMAT_RLE,
+  /** Binarnie: "GPK1", cztery liczby jak wyżej jako uint32_t little-endian
+   * i numery graczy na polach na najmniejszej liczbie bitów mieszczącej
+   * liczbę graczy, od najmłodszych bitów kolejnych bajtów. */
+  GAME_FORMAT_PACKED,
+  /** Format @ref GAME_FORMAT_PACKED w jednej ramce zstd, dostępny, gdy
+   * moduł silnika został skompilowany z makrem @p GAME_ZSTD. */
+  GAME_FORMAT_ZSTD
+} game_format_t;
+
+/** @brief Zapisuje planszę w zwartym formacie.
+ * Alokuje bufor z zapisem stanu planszy w formacie @p format. Funkcja
+ * wywołująca musi zwolnić ten bufor. W przypadku błędu ustawia @p errno
+ * na @p ENOMEM, @p EINVAL lub @p ENOTSUP, gdy format nie jest dostępny.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] format  – format zapisu,
+ * @param[out] size   – wskaźnik na długość zapisu.
+ * @return Wskaźnik na alokowany bufor lub NULL w przypadku błędu.
+ */
+void* game_export(game_t const *g, game_format_t format, size_t *size);
+
+/** @brief Odtwarza grę z zapisu planszy.
+ * Rozpoznaje format zapisu utworzonego przez @ref game_export, tworzy grę
+ * o zapisanych parametrach i ustawia pola. Obszary i liczniki graczy są
+ * liczone od nowa, więc w odtworzonej grze można dalej wykonywać ruchy.
+ * W przypadku błędu ustawia @p errno na @p ENOMEM, @p ENOTSUP lub
+ * @p EINVAL, gdy zapis jest niepoprawny lub gracz ma więcej obszarów,
+ * niż pozwala zapisany limit.
+ * @param[in] data    – zapis planszy,
+ * @param[in] size    – długość zapisu.
+ * @return Wskaźnik na utworzoną strukturę lub NULL w przypadku błędu.
+ */
+game_t* game_import(void const *data, size_t size);
+
+/** @brief Liczy od nowa obszary i liczniki graczy.
+ * Wyznacza obszary graczy, ich liczbę, liczbę zajętych pól i liczbę
+ * wolnych pól wokół obszarów wyłącznie na podstawie zawartości planszy.
+ * Plansza jest dzielona na pasy kolumn, w których części obszarów są
+ * wyznaczane niezależnie przez wątki puli @p pool, a następnie łączone
+ * wzdłuż granic pasów. Kolejność obszarów podawanych przez funkcję
+ * @ref game_areas może się zmienić. W przypadku błędu ustawia @p errno
+ * na @p ENOMEM lub @p EINVAL, gdy wskaźnik @p g ma wartość NULL albo gracz
+ * ma więcej obszarów, niż pozwala limit; wtedy grę można już tylko
+ * przywrócić funkcją @ref game_reset lub usunąć.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] pool    – pula wątków lub NULL.
+ * @return Wartość @p true, jeśli liczniki zostały wyznaczone,
+ * a @p false w przeciwnym przypadku.
+ */
+bool game_rebuild(game_t *g, game_pool_t *pool);
+
+/**
+ * To jest struktura opisująca jeden obszar gracza.
+ */
+typedef struct game_area {
+  uint64_t size;      ///< liczba pól obszaru
+  uint64_t perimeter; ///< liczba boków pól obszaru sąsiadujących z wolnym polem
+  uint32_t min_x;     ///< najmniejszy numer kolumny pola obszaru
+  uint32_t min_y;     ///< najmniejszy numer wiersza pola obszaru
+  uint32_t max_x;     ///< największy numer kolumny pola obszaru
+  uint32_t max_y;     ///< największy numer wiersza pola obszaru
+} game_area_t;
+
+/** @brief Podaje opisy obszarów gracza.
+ * Zapisuje w tablicy @p out opisy co najwyżej @p cap obszarów zajętych przez
+ * gracza @p player. Czas działania jest proporcjonalny do liczby obszarów
+ * gracza i nie zależy od rozmiaru planszy.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref game_new,
+ * @param[out] out    – tablica na opisy obszarów, może mieć wartość NULL,
+ *                      gdy @p cap jest zerem,
+ * @param[in] cap     – rozmiar tablicy @p out.
+ * @return Liczba obszarów gracza (może być większa od @p cap) lub zero,
+ * jeśli któryś z parametrów jest niepoprawny lub wskaźnik @p g ma wartość NULL.
+ */
+uint32_t game_areas(game_t const *g, uint32_t player,
+                    game_area_t *out, uint32_t cap);
+
+/**
+ * Liczba przedziałów histogramów w strukturze @ref game_stats.
+ * Przedział @p i zlicza wartości z zakresu [2^i, 2^(i+1)).
+ */
+#define GAME_STATS_BUCKETS 32
+
+/**
+ * To są etapy pracy silnika gry, których czas jest mierzony.
+ */
+enum game_stats_phase {
+  GAME_STATS_MOVE,     ///< cały wykonany ruch
+  GAME_STATS_BOUNDARY, ///< aktualizacja liczników wolnych pól wokół obszarów
+                       ///< w trakcie ruchu
+  GAME_STATS_MERGE,    ///< łączenie obszarów
+  GAME_STATS_REJECT,   ///< cały odrzucony ruch
+  GAME_STATS_RECOUNT,  ///< przeliczenie liczników całej planszy w trybie
+                       ///< @ref GAME_BOUNDARY_DEFERRED
+  GAME_STATS_PHASES    ///< liczba etapów
+};
+
+/**
+ * To jest struktura opisująca pomiary jednego etapu.
+ */
+typedef struct game_stats_timer {
+  uint64_t count;                    ///< liczba pomiarów
+  uint64_t cycles;                   ///< suma zmierzonych cykli procesora
+  uint64_t hist[GAME_STATS_BUCKETS]; ///< histogram liczby cykli
+} game_stats_timer_t;
+
+/**
+ * To jest struktura z licznikami pracy silnika gry.
+ */
+typedef struct game_stats {
+  game_stats_timer_t phase[GAME_STATS_PHASES]; ///< pomiary etapów pracy
+  uint64_t rejected[GAME_MOVE_RESULTS];        ///< odrzucone ruchy według wyniku
+  uint64_t merges;                             ///< liczba połączeń obszarów
+  uint64_t merged_fields;                      ///< pola, którym zmieniono obszar
+  uint64_t merge_hist[GAME_STATS_BUCKETS];     ///< histogram liczby tych pól
+  uint64_t boards;                             ///< wywołania @ref game_board
+  uint64_t board_bytes;                        ///< bajty opisów planszy
+} game_stats_t;
+
+/** @brief Podaje liczniki pracy silnika gry.
+ * Kopiuje do @p out aktualne liczniki gry @p g. Liczniki są zbierane tylko
+ * wtedy, gdy moduł silnika został skompilowany z makrem @p GAME_STATS;
+ * w przeciwnym przypadku struktura @p out jest zerowana.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[out] out    – wskaźnik na strukturę na liczniki.
+ * @return Wartość @p true, jeśli liczniki zostały skopiowane, a @p false,
+ * gdy liczniki nie są zbierane lub któryś ze wskaźników ma wartość NULL.
+ */
+bool game_stats(game_t const *g, game_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* GAME_H */
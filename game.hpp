@@ -0,0 +1,249 @@
+/** @file
+ * C++ interface of game's engine
+ *
+ * Header-only wrapper of game.h. @ref game_engine::Game owns the
+ * @p game_t structure and cannot be copied, only moved. Its size is
+ * the size of a pointer and every method is an inline call of the
+ * C function, so the wrapper adds no cost. Requires C++20.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#ifndef GAME_HPP
+#define GAME_HPP
+
+#include "game.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <version>
+
+#if defined(__cpp_lib_expected) && __cpp_lib_expected >= 202202L
+#include <expected>
+#endif
+
+namespace game_engine {
+
+#if defined(__cpp_lib_expected) && __cpp_lib_expected >= 202202L
+
+template <class T, class E> using Expected = std::expected<T, E>;
+template <class E> using Unexpected = std::unexpected<E>;
+
+#else
+
+/** @brief Error stored by @ref Expected.
+ * Replacement of std::unexpected for C++20
+*/
+template <class E> class Unexpected {
+public:
+    constexpr explicit Unexpected(E e) : e_(e) {}
+    constexpr E const & error() const noexcept { return e_; }
+private:
+    E e_;
+};
+
+/** @brief Value or error.
+ * Replacement of the part of std::expected used by @ref Game
+ * for C++20, T must be default constructible
+*/
+template <class T, class E> class Expected {
+public:
+    constexpr Expected(T v) : v_(std::move(v)), ok_(true) {}
+    constexpr Expected(Unexpected<E> u) : e_(u.error()), ok_(false) {}
+
+    constexpr bool has_value() const noexcept { return ok_; }
+    constexpr explicit operator bool() const noexcept { return ok_; }
+    constexpr T & value() & { return v_; }
+    constexpr T const & value() const & { return v_; }
+    constexpr T && value() && { return std::move(v_); }
+    constexpr T & operator*() & noexcept { return v_; }
+    constexpr T const & operator*() const & noexcept { return v_; }
+    constexpr T && operator*() && noexcept { return std::move(v_); }
+    constexpr T * operator->() noexcept { return &v_; }
+    constexpr T const * operator->() const noexcept { return &v_; }
+    constexpr E error() const noexcept { return e_; }
+
+private:
+    T v_{};
+    E e_{};
+    bool ok_;
+};
+
+#endif
+
+/** @brief Result of @ref Game::try_move.
+ * Changes of counters or the reason of rejection
+*/
+using MoveResult = Expected<game_move_info_t, game_move_result_t>;
+
+/** @brief Description of the board.
+ * Owns the buffer returned by @p game_board and gives views of it
+ * without copying.
+*/
+class Board {
+public:
+    Board() noexcept = default;
+    Board(char * text, uint32_t width, uint32_t height) noexcept
+        : text_(text), width_(width), height_(height) {}
+    Board(Board const &) = delete;
+    Board & operator=(Board const &) = delete;
+    Board(Board && other) noexcept
+        : text_(std::exchange(other.text_, nullptr)),
+          width_(other.width_), height_(other.height_) {}
+    Board & operator=(Board && other) noexcept {
+        if (this != &other) {
+            std::free(text_);
+            text_ = std::exchange(other.text_, nullptr);
+            width_ = other.width_;
+            height_ = other.height_;
+        }
+        return *this;
+    }
+    ~Board() { std::free(text_); }
+
+    /** @return @p false if the buffer could not be allocated */
+    explicit operator bool() const noexcept { return text_ != nullptr; }
+
+    /** @return whole description, rows from the top one */
+    std::string_view text() const noexcept {
+        return text_ ? std::string_view(text_, size()) : std::string_view();
+    }
+
+    /** @return description as bytes */
+    std::span<char const> bytes() const noexcept {
+        return text_ ? std::span<char const>(text_, size()) : std::span<char const>();
+    }
+
+    /** @brief Row of the board without the new line.
+     * @param[in] y - row's number, 0 is the bottom row as in @p game_move
+     * @return symbols of fields (0, y) ... (width - 1, y)
+     */
+    std::string_view row(uint32_t y) const noexcept {
+        return std::string_view(text_ + (uint64_t) (height_ - 1 - y) * (width_ + 1),
+                                width_);
+    }
+
+    /** @return symbol of field (x, y) */
+    char at(uint32_t x, uint32_t y) const noexcept { return row(y)[x]; }
+
+    uint32_t width() const noexcept { return width_; }
+    uint32_t height() const noexcept { return height_; }
+
+private:
+    std::size_t size() const noexcept {
+        return (std::size_t) ((uint64_t) (width_ + 1) * height_);
+    }
+
+    char * text_ = nullptr;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+};
+
+/** @brief State of the game.
+ * Move-only owner of @p game_t.
+*/
+class Game {
+public:
+    /** @brief Creates the game, see @p game_new.
+     * @return the game or @p errno value: ENOMEM when memory could not be
+     * allocated and EINVAL when a parameter is wrong
+     */
+    static Expected<Game, int> create(uint32_t width, uint32_t height,
+                                      uint32_t players, uint32_t areas) noexcept {
+        errno = 0;
+        game_t * g = game_new(width, height, players, areas);
+        if (g == nullptr) { return Unexpected<int>(errno == ENOMEM ? ENOMEM : EINVAL); }
+        return Game(g);
+    }
+
+    Game() noexcept = default;
+    /** @brief Takes ownership of @p g. */
+    explicit Game(game_t * g) noexcept : g_(g) {}
+    Game(Game const &) = delete;
+    Game & operator=(Game const &) = delete;
+    Game(Game && other) noexcept : g_(std::exchange(other.g_, nullptr)) {}
+    Game & operator=(Game && other) noexcept {
+        if (this != &other) {
+            game_delete(g_);
+            g_ = std::exchange(other.g_, nullptr);
+        }
+        return *this;
+    }
+    ~Game() { game_delete(g_); }
+
+    explicit operator bool() const noexcept { return g_ != nullptr; }
+    game_t * get() const noexcept { return g_; }
+    /** @brief Gives up ownership, the caller must call @p game_delete. */
+    game_t * release() noexcept { return std::exchange(g_, nullptr); }
+
+    /** @see game_move */
+    bool move(uint32_t player, uint32_t x, uint32_t y) noexcept {
+        return game_move(g_, player, x, y);
+    }
+
+    /** @see game_move_ex */
+    MoveResult try_move(uint32_t player, uint32_t x, uint32_t y) noexcept {
+        game_move_info_t info;
+        game_move_result_t result = game_move_ex(g_, player, x, y, &info);
+        if (result != GAME_MOVE_OK) { return Unexpected<game_move_result_t>(result); }
+        return info;
+    }
+
+    /** @see game_can_move */
+    bool can_move(uint32_t player, uint32_t x, uint32_t y) const noexcept {
+        return game_can_move(g_, player, x, y);
+    }
+
+    /** @brief See @p game_can_move_mask.
+     * @return number of legal fields or zero if @p mask is too small
+     */
+    uint64_t can_move_mask(uint32_t player, uint32_t x, uint32_t y,
+                           uint32_t w, uint32_t h,
+                           std::span<uint8_t> mask) const noexcept {
+        if (mask.size() < (uint64_t) h * ((w + 7ull) / 8)) { return 0; }
+        return game_can_move_mask(g_, player, x, y, w, h, mask.data());
+    }
+
+    uint64_t busy_fields(uint32_t player) const noexcept {
+        return game_busy_fields(g_, player);
+    }
+    uint64_t free_fields(uint32_t player) const noexcept {
+        return game_free_fields(g_, player);
+    }
+    uint32_t width() const noexcept { return game_board_width(g_); }
+    uint32_t height() const noexcept { return game_board_height(g_); }
+    uint32_t players() const noexcept { return game_players(g_); }
+    char symbol(uint32_t player) const noexcept { return game_player(g_, player); }
+
+    /** @brief See @p game_areas.
+     * @return number of player's areas, may be larger than @p out
+     */
+    uint32_t areas(uint32_t player, std::span<game_area_t> out) const noexcept {
+        return game_areas(g_, player, out.data(), (uint32_t) out.size());
+    }
+
+    /** @brief See @p game_board.
+     * @return description, empty when memory could not be allocated
+     */
+    Board board() const noexcept {
+        return Board(game_board(g_), width(), height());
+    }
+
+    /** @see game_stats */
+    bool stats(game_stats_t & out) const noexcept { return game_stats(g_, &out); }
+
+private:
+    game_t * g_ = nullptr;
+};
+
+static_assert(sizeof(Game) == sizeof(game_t *), "Game must stay a pointer");
+
+} // namespace game_engine
+
+#endif /* GAME_HPP */
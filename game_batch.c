@@ -0,0 +1,286 @@
+/** @file
+ * Batch mode of the game
+ *
+ * Reads commands from the standard input, one per line:
+ *
+ *     B width height players areas   starts the game (first command)
+ *     m player x y                   prints 1 or 0, see game_move
+ *     b player                       prints game_busy_fields
+ *     f player                       prints game_free_fields
+ *     p                              prints game_board
+ *
+ * Empty lines and lines starting with '#' are ignored, lines may end
+ * with CR LF. For a wrong line, also for a player out of the range
+ * 1..players, "ERROR n" is printed on the standard error output, where
+ * n is the line's number. Parameters of B can also be given as arguments
+ * of the program. The input is mapped into memory when it is a file
+ * and read in large blocks otherwise; replies are gathered in one
+ * output buffer.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#define _GNU_SOURCE
+
+#include "game.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Size of input blocks and of the output buffer
+#define BUFFER_SIZE (1 << 20)
+
+/** @brief Representation of the interpreter
+ * g - the game, NULL before command B
+ * line - number of the current line
+ * out - buffered replies
+ * out_len - number of buffered bytes
+*/
+struct batch {
+    game_t * g;
+    uint64_t line;
+    char * out;
+    size_t out_len;
+};
+typedef struct batch batch_t;
+
+/** @brief write_all.
+ * Writes bytes to the standard output
+ * @param[in] data - bytes to write
+ * @param[in] len - number of bytes
+*/
+static void write_all(const char * data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(STDOUT_FILENO, data + done, len - done);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { break; }
+        done += (size_t) n;
+    }
+}
+
+/** @brief flush.
+ * Writes buffered replies to the standard output
+ * @param[in,out] b - interpreter
+*/
+static void flush(batch_t * b) {
+    write_all(b->out, b->out_len);
+    b->out_len = 0;
+}
+
+/** @brief put_number.
+ * Buffers a number and a new line
+ * @param[in,out] b - interpreter
+ * @param[in] value - number to print
+*/
+static inline void put_number(batch_t * b, uint64_t value) {
+    if (b->out_len + 21 > BUFFER_SIZE) { flush(b); }
+    char tmp[21];
+    size_t len = sizeof(tmp);
+    tmp[--len] = '\n';
+    do {
+        tmp[--len] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value);
+    memcpy(b->out + b->out_len, tmp + len, sizeof(tmp) - len);
+    b->out_len += sizeof(tmp) - len;
+}
+
+/** @brief put_board.
+ * Prints description of the board
+ * @param[in,out] b - interpreter
+ * @return @p false if memory could not be allocated
+*/
+static bool put_board(batch_t * b) {
+    char * board = game_board(b->g);
+    if (board == NULL) { return false; }
+    size_t len = strlen(board);
+    if (b->out_len + len > BUFFER_SIZE) { flush(b); }
+    if (len > BUFFER_SIZE) {
+        write_all(board, len);
+    } else {
+        memcpy(b->out + b->out_len, board, len);
+        b->out_len += len;
+    }
+    free(board);
+    return true;
+}
+
+/** @brief parse_args.
+ * Reads numbers separated by spaces or tabs till the end of the line
+ * @param[in] p - first character after the command
+ * @param[in] end - end of the line
+ * @param[out] args - read numbers
+ * @param[in] count - expected number of arguments
+ * @return @p true if exactly @p count numbers were read
+*/
+static inline bool parse_args(const char * p, const char * end,
+                              uint32_t * args, int count) {
+    for (int i = 0; i < count; i++) {
+        if (p == end || (*p != ' ' && *p != '\t')) { return false; }
+        do { p++; } while (p < end && (*p == ' ' || *p == '\t'));
+        if (p == end || (unsigned) (*p - '0') > 9) { return false; }
+        uint64_t value = 0;
+        do {
+            value = value * 10 + (uint64_t) (*p - '0');
+            p++;
+        } while (p < end && (unsigned) (*p - '0') <= 9 && value <= UINT32_MAX);
+        if (value > UINT32_MAX) { return false; }
+        args[i] = (uint32_t) value;
+    }
+    while (p < end && (*p == ' ' || *p == '\t')) { p++; }
+    return p == end;
+}
+
+/** @brief execute.
+ * Executes one line
+ * @param[in,out] b - interpreter
+ * @param[in] line - beginning of the line
+ * @param[in] end - end of the line, without the new line character
+ * @return @p false if the line is wrong
+*/
+static inline bool execute(batch_t * b, const char * line, const char * end) {
+    uint32_t args[4];
+    // lines ended with CR LF are accepted too, also the last one
+    if (end > line && end[-1] == '\r') { end--; }
+    if (line == end || *line == '#') { return true; }
+    if (b->g == NULL) {
+        if (*line != 'B' || !parse_args(line + 1, end, args, 4)) { return false; }
+        b->g = game_new(args[0], args[1], args[2], args[3]);
+        return b->g != NULL;
+    }
+
+    switch (*line) {
+        case 'm':
+            if (!parse_args(line + 1, end, args, 3)
+                || !args[0] || args[0] > game_players(b->g)) { return false; }
+            if (b->out_len + 2 > BUFFER_SIZE) { flush(b); }
+            b->out[b->out_len++] = game_move(b->g, args[0], args[1], args[2])
+                                   ? '1' : '0';
+            b->out[b->out_len++] = '\n';
+            return true;
+        case 'b':
+            if (!parse_args(line + 1, end, args, 1)
+                || !args[0] || args[0] > game_players(b->g)) { return false; }
+            put_number(b, game_busy_fields(b->g, args[0]));
+            return true;
+        case 'f':
+            if (!parse_args(line + 1, end, args, 1)
+                || !args[0] || args[0] > game_players(b->g)) { return false; }
+            put_number(b, game_free_fields(b->g, args[0]));
+            return true;
+        case 'p':
+            return parse_args(line + 1, end, args, 0) && put_board(b);
+    }
+    return false;
+}
+
+/** @brief error.
+ * Reports wrong line
+ * @param[in,out] b - interpreter
+*/
+static void error(batch_t * b) {
+    flush(b);
+    fprintf(stderr, "ERROR %llu\n", (unsigned long long) b->line);
+}
+
+/** @brief run.
+ * Executes all complete lines of the block
+ * @param[in,out] b - interpreter
+ * @param[in] data - block of the input
+ * @param[in] len - length of the block
+ * @return number of bytes used, the rest is a part of the next line
+*/
+static size_t run(batch_t * b, const char * data, size_t len) {
+    const char * p = data;
+    const char * end = data + len;
+    const char * nl;
+    while ((nl = memchr(p, '\n', (size_t) (end - p))) != NULL) {
+        b->line++;
+        if (!execute(b, p, nl)) { error(b); }
+        p = nl + 1;
+    }
+    return (size_t) (p - data);
+}
+
+/** @brief Runs batch mode.
+ * Usage: game_batch [width height players areas] < commands
+ * @return Zero on success and 1 on error
+ */
+int main(int argc, char *argv[]) {
+    static batch_t b;
+    b.out = (char *) malloc(BUFFER_SIZE);
+    if (b.out == NULL) { return 1; }
+    if (argc == 5) {
+        b.g = game_new((uint32_t) strtoul(argv[1], NULL, 10),
+                       (uint32_t) strtoul(argv[2], NULL, 10),
+                       (uint32_t) strtoul(argv[3], NULL, 10),
+                       (uint32_t) strtoul(argv[4], NULL, 10));
+        if (b.g == NULL) {
+            fprintf(stderr, "%s: wrong parameters\n", argv[0]);
+            return 1;
+        }
+    }
+
+    struct stat st;
+    void * map = MAP_FAILED;
+    if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+                   STDIN_FILENO, 0);
+    }
+
+    if (map != MAP_FAILED) {
+        madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+        size_t used = run(&b, (const char *) map, (size_t) st.st_size);
+        if (used < (size_t) st.st_size) {
+            // the last line without the new line character
+            b.line++;
+            if (!execute(&b, (const char *) map + used,
+                         (const char *) map + st.st_size)) { error(&b); }
+        }
+        munmap(map, (size_t) st.st_size);
+    } else {
+        char * in = (char *) malloc(2 * BUFFER_SIZE);
+        if (in == NULL) { return 1; }
+        size_t len = 0;
+        bool too_long = false;
+        for (;;) {
+            ssize_t n = read(STDIN_FILENO, in + len, 2 * BUFFER_SIZE - len);
+            if (n < 0 && errno == EINTR) { continue; }
+            if (n <= 0) { break; }
+            len += (size_t) n;
+            size_t used = 0;
+            if (too_long) {
+                // rest of the too long line
+                char * nl = memchr(in, '\n', len);
+                if (nl == NULL) { len = 0; continue; }
+                used = (size_t) (nl - in) + 1;
+                too_long = false;
+            }
+            used += run(&b, in + used, len - used);
+            if (used == 0 && len == 2 * BUFFER_SIZE) {
+                // too long line, it is wrong anyway
+                b.line++;
+                error(&b);
+                too_long = true;
+                len = 0;
+                continue;
+            }
+            len -= used;
+            memmove(in, in + used, len);
+        }
+        if (len > 0 && !too_long) {
+            b.line++;
+            if (!execute(&b, in, in + len)) { error(&b); }
+        }
+        free(in);
+    }
+
+    flush(&b);
+    free(b.out);
+    game_delete(b.g);
+    return 0;
+}
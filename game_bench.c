@@ -0,0 +1,1035 @@
+/** @file
+ * Benchmarks of game's engine
+ *
+ * Usage: game_bench mode [arguments]
+ *
+ *     random [size players areas games]
+ *                     random moves on a square board, 3 * size * size
+ *                     moves per game
+ *     fixed [games rounds]
+ *                     generic engine against engines specialized
+ *                     by game_fixed.h on 19x19 and 32x32 boards,
+ *                     medians of the rounds and the spread of the ratio
+ *     churn [size games]
+ *                     short games created by game_new, by game_new_in
+ *                     in one reused block and taken from game_cache
+ *     board [size boards threads]
+ *                     game_board, game_board_write to /dev/null and
+ *                     game_board_parallel with up to threads threads
+ *                     on a square board filled by random moves
+ *     export [size players areas]
+ *                     sizes and times of game_export and game_import
+ *     pages [size players areas]
+ *                     random moves and game_board on games created by
+ *                     game_new_ex with each kind of pages
+ *     replay [size players areas threads]
+ *                     random moves with exact and deferred boundaries
+ *                     and the first query of free fields after them
+ *     rebuild [size players threads]
+ *                     game_rebuild of a board filled by random moves
+ *                     on 1, 2, 4... up to threads threads
+ *     planes [size players games threads]
+ *                     game_feature_planes in every layout and type and
+ *                     the batch export against planes built from
+ *                     game_board and game_can_move
+ *     search [size areas depth threads]
+ *                     nodes per second of game_search from the empty
+ *                     board on 1, 2, 4... up to threads threads
+ *     latency [size games]
+ *                     percentiles of the time of single game_move calls
+ *                     for random moves and for adversarial boards: two
+ *                     serpentine areas merged by one move and a comb
+ *                     of lines merged one by one
+ *
+ * The layout of the board is chosen when the engine is compiled, so
+ * the column-major and the tiled (make TILED=1) boards are compared
+ * by running the same mode on both builds, for example under
+ * perf stat -e cache-misses.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#define _GNU_SOURCE
+
+#include "game.h"
+#include "game_search.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define GAME_FIXED_NAME    game19
+#define GAME_FIXED_WIDTH   19
+#define GAME_FIXED_HEIGHT  19
+#define GAME_FIXED_PLAYERS 2
+#define GAME_FIXED_AREAS   16
+#include "game_fixed.h"
+
+#define GAME_FIXED_NAME    game32
+#define GAME_FIXED_WIDTH   32
+#define GAME_FIXED_HEIGHT  32
+#define GAME_FIXED_PLAYERS 2
+#define GAME_FIXED_AREAS   16
+#include "game_fixed.h"
+
+/** @brief Pre-generated move
+ * player, x, y - arguments of @ref game_move
+*/
+struct move {
+    uint32_t player;
+    uint32_t x;
+    uint32_t y;
+};
+typedef struct move move_t;
+
+/** @brief next_random.
+ * xorshift64 generator
+ * @param[in,out] state - generator's state
+ * @return next number
+*/
+static uint64_t next_random(uint64_t * state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/** @brief random_moves.
+ * Generates random moves
+ * @param[in] count - number of moves
+ * @param[in] width - board's width
+ * @param[in] height - board's height
+ * @param[in] players - number of players
+ * @param[in] seed - seed of the generator
+ * @return array of moves or NULL if memory could not be allocated
+*/
+static move_t * random_moves(uint64_t count, uint32_t width, uint32_t height,
+                             uint32_t players, uint64_t seed) {
+    move_t * moves = (move_t *) malloc(count * sizeof(move_t));
+    if (moves == NULL) { return NULL; }
+    uint64_t state = seed | 1;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t r = next_random(&state);
+        moves[i].player = (uint32_t) (r % players) + 1;
+        moves[i].x = (uint32_t) ((r >> 16) % width);
+        moves[i].y = (uint32_t) ((r >> 40) % height);
+    }
+    return moves;
+}
+
+/** @brief now.
+ * @return monotonic time in seconds
+*/
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/** @brief now_ns.
+ * @return monotonic time in nanoseconds
+*/
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/** @brief arg.
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments
+ * @param[in] i - index of the argument
+ * @param[in] def - default value
+ * @return value of the argument or @p def if it is not given
+*/
+static uint32_t arg(int argc, char *argv[], int i, uint32_t def) {
+    return i < argc ? (uint32_t) strtoul(argv[i], NULL, 10) : def;
+}
+
+/** @brief bench_random.
+ * Measures random moves of the generic engine
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, players, areas, games
+ * @return @p true on success
+*/
+static bool bench_random(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 100);
+    uint32_t players = arg(argc, argv, 1, 4);
+    uint32_t areas = arg(argc, argv, 2, 10000);
+    uint32_t games = arg(argc, argv, 3, 200);
+    if (!size || !players || !areas || !games) { return false; }
+
+    uint64_t per_game = 3 * (uint64_t) size * size;
+    move_t * moves = random_moves(per_game, size, size, players, size);
+    if (moves == NULL) { return false; }
+
+    double best = 1e30;
+    uint64_t accepted = 0;
+    for (uint32_t i = 0; i < games; i++) {
+        game_t * g = game_new(size, size, players, areas);
+        if (g == NULL) { free(moves); return false; }
+        double start = now();
+        accepted = 0;
+        for (uint64_t k = 0; k < per_game; k++) {
+            accepted += game_move(g, moves[k].player, moves[k].x, moves[k].y);
+        }
+        double t = now() - start;
+        if (t < best) { best = t; }
+        game_delete(g);
+    }
+    free(moves);
+
+    printf("%ux%u  players %u  areas %u  accepted %llu/%llu\n", size, size,
+           players, areas, (unsigned long long) accepted,
+           (unsigned long long) per_game);
+    printf("best game  %.2f ns/move  %.2f Mmoves/s\n",
+           best * 1e9 / (double) per_game, (double) per_game / best / 1e6);
+    return true;
+}
+
+/** @brief time_board.
+ * @param[in] g - the game
+ * @param[in] pool - pool of @ref game_board_parallel, NULL for game_board
+ * @param[in] boards - number of descriptions
+ * @return best time of a description in seconds or a negative number
+ * if memory could not be allocated
+*/
+static double time_board(game_t const *g, game_pool_t *pool, uint32_t boards) {
+    double best = 1e30;
+    for (uint32_t i = 0; i < boards; i++) {
+        double start = now();
+        char * text = pool ? game_board_parallel(g, pool) : game_board(g);
+        double t = now() - start;
+        if (text == NULL) { return -1; }
+        free(text);
+        if (t < best) { best = t; }
+    }
+    return best;
+}
+
+/** @brief bench_churn.
+ * Measures many short games, each created with game_new,
+ * in one reused block with game_new_in or taken from game_cache
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, number of games
+ * @return @p true on success
+*/
+static bool bench_churn(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 19);
+    uint32_t games = arg(argc, argv, 1, 200000);
+    if (!size || !games) { return false; }
+
+    const uint32_t per_game = 64;
+    move_t * moves = random_moves(per_game, size, size, 2, size);
+    size_t bytes = game_footprint(size, size, 2, 16);
+    void * block = malloc(bytes);
+    if (moves == NULL || block == NULL) { free(moves); free(block); return false; }
+
+    game_cache_t * cache = game_cache_new();
+    double times[3];
+    uint64_t accepted[3] = { 0, 0, 0 };
+    for (int way = 0; cache != NULL && way < 3; way++) {
+        double start = now();
+        for (uint32_t i = 0; i < games; i++) {
+            game_t * g = way == 0 ? game_new(size, size, 2, 16)
+                       : way == 1 ? game_new_in(block, bytes, size, size, 2, 16)
+                       : game_cache_get(cache, size, size, 2, 16);
+            if (g == NULL) { break; }
+            for (uint32_t k = 0; k < per_game; k++) {
+                accepted[way] += game_move(g, moves[k].player, moves[k].x,
+                                           moves[k].y);
+            }
+            if (way == 2) {
+                game_cache_put(cache, g);
+            } else {
+                game_delete(g);
+            }
+        }
+        times[way] = now() - start;
+    }
+    free(moves);
+    free(block);
+    if (cache == NULL) { return false; }
+    game_cache_delete(cache);
+
+    printf("%ux%u  footprint %zu bytes  %u moves per game\n", size, size, bytes,
+           per_game);
+    printf("game_new     %8.1f ns/game\ngame_new_in  %8.1f ns/game\n"
+           "game_cache   %8.1f ns/game\n", times[0] * 1e9 / games,
+           times[1] * 1e9 / games, times[2] * 1e9 / games);
+    return accepted[0] == accepted[1] && accepted[0] == accepted[2];
+}
+
+/** @brief bench_board.
+ * Measures descriptions of a filled board, serial and parallel
+ * with 1, 2, 4 ... threads
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, number of descriptions,
+ * maximal number of threads
+ * @return @p true on success
+*/
+static bool bench_board(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 2000);
+    uint32_t boards = arg(argc, argv, 1, 20);
+    uint32_t threads = arg(argc, argv, 2, 0);
+    if (!size || !boards) { return false; }
+    if (!threads) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t) online : 1;
+    }
+
+    uint64_t fields = (uint64_t) size * size;
+    move_t * moves = random_moves(2 * fields, size, size, 4, size);
+    game_t * g = game_new(size, size, 4, size * size);
+    if (moves == NULL || g == NULL) { free(moves); game_delete(g); return false; }
+    for (uint64_t k = 0; k < 2 * fields; k++) {
+        game_move(g, moves[k].player, moves[k].x, moves[k].y);
+    }
+    free(moves);
+
+    double serial = time_board(g, NULL, boards);
+    if (serial < 0) { game_delete(g); return false; }
+    printf("%ux%u  game_board           %8.3f ms  %.2f ns/field\n", size, size,
+           serial * 1e3, serial * 1e9 / (double) fields);
+
+    int null = open("/dev/null", O_WRONLY);
+    double written = 1e30;
+    for (uint32_t i = 0; null >= 0 && i < boards; i++) {
+        double start = now();
+        bool ok = game_board_write(g, null);
+        double t = now() - start;
+        if (ok && t < written) { written = t; }
+    }
+    if (null >= 0) {
+        close(null);
+        printf("%ux%u  game_board_write     %8.3f ms  %.2f ns/field\n", size, size,
+               written * 1e3, written * 1e9 / (double) fields);
+    }
+
+    for (uint32_t n = 1; n <= threads; n *= 2) {
+        game_pool_t * pool = game_pool_new(n);
+        if (pool == NULL) { game_delete(g); return false; }
+        double t = time_board(g, pool, boards);
+        game_pool_delete(pool);
+        if (t < 0) { game_delete(g); return false; }
+        printf("%ux%u  parallel %3u threads %8.3f ms  %.2f GB/s  x%.2f\n",
+               size, size, n, t * 1e3, (double) fields / t / 1e9, serial / t);
+        if (n > threads / 2 && n != threads) { n = threads / 2; }
+    }
+    game_delete(g);
+    return true;
+}
+
+/** @brief bench_export.
+ * Measures exporters and importers on a board filled by random moves
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, players, areas
+ * @return @p true if every available format gave back the same board
+*/
+static bool bench_export(int argc, char *argv[]) {
+    static const char * const names[] = { "rle", "packed", "zstd" };
+    uint32_t size = arg(argc, argv, 0, 1000);
+    uint32_t players = arg(argc, argv, 1, 4);
+    uint32_t areas = arg(argc, argv, 2, 100);
+    if (!size || !players || !areas) { return false; }
+
+    uint64_t fields = (uint64_t) size * size;
+    move_t * moves = random_moves(3 * fields, size, size, players, size);
+    game_t * g = game_new(size, size, players, areas);
+    if (moves == NULL || g == NULL) { free(moves); game_delete(g); return false; }
+    for (uint64_t k = 0; k < 3 * fields; k++) {
+        game_move(g, moves[k].player, moves[k].x, moves[k].y);
+    }
+    free(moves);
+    char * text = game_board(g);
+    if (text == NULL) { game_delete(g); return false; }
+    printf("%ux%u  players %u  areas %u  text %llu bytes\n", size, size, players,
+           areas, (unsigned long long) strlen(text));
+
+    bool same = true;
+    for (int f = GAME_FORMAT_RLE; f <= GAME_FORMAT_ZSTD; f++) {
+        size_t bytes;
+        double start = now();
+        void * data = game_export(g, (game_format_t) f, &bytes);
+        double exported = now() - start;
+        if (data == NULL) {
+            printf("%-7s %s\n", names[f], strerror(errno));
+            continue;
+        }
+        start = now();
+        game_t * copy = game_import(data, bytes);
+        double imported = now() - start;
+        free(data);
+
+        char * back = copy ? game_board(copy) : NULL;
+        bool ok = back != NULL && strcmp(back, text) == 0;
+        for (uint32_t p = 1; ok && p <= players; p++) {
+            ok = game_free_fields(copy, p) == game_free_fields(g, p);
+        }
+        same = same && ok;
+        printf("%-7s %10zu bytes  %6.2f%%  export %8.3f ms  import %8.3f ms%s\n",
+               names[f], bytes, 100.0 * (double) bytes / (double) strlen(text),
+               exported * 1e3, imported * 1e3, ok ? "" : "  RESULTS DIFFER");
+        free(back);
+        game_delete(copy);
+    }
+    free(text);
+    game_delete(g);
+    return same;
+}
+
+/** @brief bench_pages.
+ * Measures random moves and game_board on games created by game_new_ex
+ * with each kind of pages and with NUMA interleaving on node 0
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, players, areas
+ * @return @p true on success
+*/
+static bool bench_pages(int argc, char *argv[]) {
+    static const struct {
+        const char * name;
+        game_pages_t pages;
+        game_numa_t numa;
+    } variants[] = {
+        { "calloc", GAME_PAGES_DEFAULT, GAME_NUMA_DEFAULT },
+        { "thp", GAME_PAGES_TRANSPARENT, GAME_NUMA_DEFAULT },
+        { "hugetlb", GAME_PAGES_HUGE, GAME_NUMA_DEFAULT },
+        { "interleave", GAME_PAGES_DEFAULT, GAME_NUMA_INTERLEAVE },
+    };
+    uint32_t size = arg(argc, argv, 0, 4000);
+    uint32_t players = arg(argc, argv, 1, 4);
+    uint32_t areas = arg(argc, argv, 2, 1000000);
+    if (!size || !players || !areas) { return false; }
+
+    uint64_t per_game = 3 * (uint64_t) size * size;
+    move_t * moves = random_moves(per_game, size, size, players, size);
+    if (moves == NULL) { return false; }
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        game_options_t options = { size, size, players, areas,
+                                   variants[v].pages, variants[v].numa, 1 };
+        errno = 0;
+        game_t * g = game_new_ex(&options);
+        if (g == NULL) {
+            printf("%-10s  %s\n", variants[v].name, strerror(errno));
+            continue;
+        }
+        double start = now();
+        for (uint64_t k = 0; k < per_game; k++) {
+            game_move(g, moves[k].player, moves[k].x, moves[k].y);
+        }
+        double moved = now() - start;
+        start = now();
+        char * text = game_board(g);
+        double rendered = now() - start;
+        free(text);
+        game_delete(g);
+        printf("%-10s  %6.2f ns/move  board %8.3f ms\n", variants[v].name,
+               moved * 1e9 / (double) per_game, rendered * 1e3);
+    }
+    free(moves);
+    return true;
+}
+
+/** @brief bench_replay.
+ * Replays the same random moves in the exact and in the deferred
+ * boundary mode and asks for every player's free fields at the end,
+ * the deferred mode recounts once serially and once on a pool
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, players, areas, threads
+ * @return @p true if all of the modes gave the same results
+*/
+static bool bench_replay(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 2000);
+    uint32_t players = arg(argc, argv, 1, 4);
+    uint32_t areas = arg(argc, argv, 2, 1000000);
+    uint32_t threads = arg(argc, argv, 3, 0);
+    if (!size || !players || !areas) { return false; }
+
+    uint64_t per_game = 3 * (uint64_t) size * size;
+    move_t * moves = random_moves(per_game, size, size, players, size);
+    game_pool_t * pool = game_pool_new(threads);
+    uint64_t * exact = (uint64_t *) calloc(players, sizeof(uint64_t));
+    if (moves == NULL || pool == NULL || exact == NULL) {
+        free(moves);
+        game_pool_delete(pool);
+        free(exact);
+        return false;
+    }
+
+    static const char * const names[] = { "exact", "deferred", "deferred+pool" };
+    bool same = true;
+    for (int v = 0; v < 3; v++) {
+        game_t * g = game_new(size, size, players, areas);
+        if (g == NULL) { same = false; break; }
+        if (v > 0) {
+            game_set_boundary(g, GAME_BOUNDARY_DEFERRED, v == 2 ? pool : NULL);
+        }
+        double start = now();
+        for (uint64_t k = 0; k < per_game; k++) {
+            game_move(g, moves[k].player, moves[k].x, moves[k].y);
+        }
+        double moved = now() - start;
+        start = now();
+        uint32_t area_num = 0;
+        for (uint32_t p = 1; p <= players; p++) {
+            uint64_t fields = game_free_fields(g, p);
+            area_num += game_areas(g, p, NULL, 0);
+            if (v == 0) { exact[p - 1] = fields; }
+            same = same && fields == exact[p - 1];
+        }
+        double queried = now() - start;
+        game_delete(g);
+        printf("%-14s %6.2f ns/move  first query %8.3f ms  areas %u\n", names[v],
+               moved * 1e9 / (double) per_game, queried * 1e3, area_num);
+    }
+    printf("threads %u%s\n", game_pool_threads(pool), same ? "" : "  RESULTS DIFFER");
+    free(moves);
+    game_pool_delete(pool);
+    free(exact);
+    return same;
+}
+
+/** @brief bench_rebuild.
+ * Measures game_rebuild of a board filled by random moves, serially
+ * and on pools of up to threads threads, against replaying the moves
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, players, threads
+ * @return @p true if every rebuild gave the counters of the moves
+*/
+static bool bench_rebuild(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 4000);
+    uint32_t players = arg(argc, argv, 1, 4);
+    uint32_t threads = arg(argc, argv, 2, 4);
+    if (!size || !players || !threads) { return false; }
+
+    uint64_t per_game = 3 * (uint64_t) size * size;
+    move_t * moves = random_moves(per_game, size, size, players, size);
+    game_t * g = game_new(size, size, players, UINT32_MAX);
+    uint64_t * expected = (uint64_t *) calloc(2 * (size_t) players, sizeof(uint64_t));
+    if (moves == NULL || g == NULL || expected == NULL) {
+        free(moves);
+        game_delete(g);
+        free(expected);
+        return false;
+    }
+    double start = now();
+    for (uint64_t k = 0; k < per_game; k++) {
+        game_move(g, moves[k].player, moves[k].x, moves[k].y);
+    }
+    printf("moves           %8.3f ms\n", (now() - start) * 1e3);
+    free(moves);
+    for (uint32_t p = 1; p <= players; p++) {
+        expected[2 * (p - 1)] = game_free_fields(g, p);
+        expected[2 * (p - 1) + 1] = game_areas(g, p, NULL, 0);
+    }
+
+    bool same = true;
+    for (uint32_t t = 1; t <= threads; t *= 2) {
+        game_pool_t * pool = t > 1 ? game_pool_new(t) : NULL;
+        if (t > 1 && pool == NULL) { same = false; break; }
+        start = now();
+        bool ok = game_rebuild(g, pool);
+        double rebuilt = now() - start;
+        game_pool_delete(pool);
+        for (uint32_t p = 1; ok && p <= players; p++) {
+            ok = game_free_fields(g, p) == expected[2 * (p - 1)] &&
+                 game_areas(g, p, NULL, 0) == expected[2 * (p - 1) + 1];
+        }
+        same = same && ok;
+        printf("rebuild %2u      %8.3f ms%s\n", t, rebuilt * 1e3,
+               ok ? "" : "  RESULTS DIFFER");
+    }
+    game_delete(g);
+    free(expected);
+    return same;
+}
+
+/** @brief planes_from_text.
+ * Builds u8 NCHW planes the old way, from game_board and game_can_move
+ * @param[in] g - the game
+ * @param[out] out - the planes
+ * @return @p true on success
+*/
+static bool planes_from_text(game_t const *g, uint8_t *out) {
+    uint32_t w = game_board_width(g);
+    uint32_t h = game_board_height(g);
+    uint32_t players = game_players(g);
+    char * text = game_board(g);
+    if (text == NULL) { return false; }
+    for (uint32_t p = 1; p <= players; p++) {
+        char symbol = game_player(g, p);
+        uint8_t * owner = out + (size_t) (p - 1) * h * w;
+        uint8_t * legal = out + (size_t) (players + p - 1) * h * w;
+        for (uint32_t y = 0; y < h; y++) {
+            for (uint32_t x = 0; x < w; x++) {
+                owner[(size_t) y * w + x] = text[(size_t) (h - 1 - y) * (w + 1) + x] == symbol;
+                legal[(size_t) y * w + x] = game_can_move(g, p, x, y);
+            }
+        }
+    }
+    free(text);
+    return true;
+}
+
+/** @brief bench_planes.
+ * Measures game_feature_planes in both layouts and types against
+ * planes built from the text of the board, and the batch export
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, players, games, threads
+ * @return @p true if all of the ways gave the same planes
+*/
+static bool bench_planes(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 19);
+    uint32_t players = arg(argc, argv, 1, 2);
+    uint32_t games = arg(argc, argv, 2, 1000);
+    uint32_t threads = arg(argc, argv, 3, 0);
+    if (!size || !players || !games) { return false; }
+
+    size_t per_game = 2 * (size_t) players * size * size;
+    uint64_t fields = (uint64_t) size * size;
+    move_t * moves = random_moves(fields, size, size, players, size);
+    game_t ** g = (game_t **) calloc(games, sizeof(game_t *));
+    uint8_t * text = (uint8_t *) malloc(per_game * games);
+    void * out = malloc(per_game * games * sizeof(float));
+    game_pool_t * pool = game_pool_new(threads);
+    bool same = moves != NULL && g != NULL && text != NULL && out != NULL && pool != NULL;
+    for (uint32_t i = 0; same && i < games; i++) {
+        g[i] = game_new(size, size, players, size);
+        same = g[i] != NULL;
+        // games differ by the number of moves made
+        for (uint64_t k = 0; same && k < (i * 7919u) % fields; k++) {
+            game_move(g[i], moves[k].player, moves[k].x, moves[k].y);
+        }
+    }
+
+    if (same) {
+        double start = now();
+        for (uint32_t i = 0; i < games; i++) {
+            same = planes_from_text(g[i], text + i * per_game) && same;
+        }
+        printf("text+can_move    %9.3f us/game\n", (now() - start) * 1e6 / games);
+    }
+    static const char * const names[2][2] = {
+        { "nchw u8", "nchw f32" }, { "nhwc u8", "nhwc f32" }
+    };
+    for (int layout = GAME_LAYOUT_NCHW; same && layout <= GAME_LAYOUT_NHWC; layout++) {
+        for (int type = GAME_PLANES_U8; same && type <= GAME_PLANES_F32; type++) {
+            double start = now();
+            for (uint32_t i = 0; same && i < games; i++) {
+                size_t element = type == GAME_PLANES_U8 ? 1 : sizeof(float);
+                same = game_feature_planes(g[i], (char *) out + i * per_game * element,
+                                           (game_layout_t) layout,
+                                           (game_planes_type_t) type);
+            }
+            double single = now() - start;
+            start = now();
+            same = same && game_feature_planes_batch((game_t const * const *) g, games,
+                                                     out, (game_layout_t) layout,
+                                                     (game_planes_type_t) type, pool);
+            double batch = now() - start;
+            if (same && layout == GAME_LAYOUT_NCHW && type == GAME_PLANES_U8) {
+                same = memcmp(out, text, per_game * games) == 0;
+            }
+            printf("%-16s %9.3f us/game  batch %9.3f us/game\n", names[layout][type],
+                   single * 1e6 / games, batch * 1e6 / games);
+        }
+    }
+    printf("threads %u%s\n", game_pool_threads(pool), same ? "" : "  RESULTS DIFFER");
+
+    for (uint32_t i = 0; g != NULL && i < games; i++) { game_delete(g[i]); }
+    free(g);
+    free(moves);
+    free(text);
+    free(out);
+    game_pool_delete(pool);
+    return same;
+}
+
+/** @brief bench_search.
+ * Measures nodes per second of game_search of two players
+ * on 1, 2, 4... up to threads threads of lazy SMP
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, areas, depth, threads
+ * @return @p true if every search completed its first iteration
+*/
+static bool bench_search(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 6);
+    uint32_t areas = arg(argc, argv, 1, 2);
+    uint32_t depth = arg(argc, argv, 2, 10);
+    uint32_t threads = arg(argc, argv, 3, 0);
+    if (!size || !areas || (uint64_t) size * size > GAME_SEARCH_MAX_FIELDS) { return false; }
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t) online : 1;
+    }
+
+    game_t * g = game_new(size, size, 2, areas);
+    bool ok = g != NULL;
+    for (uint32_t t = 1; ok; t = t * 2 > threads && t < threads ? threads : t * 2) {
+        game_pool_t * pool = game_pool_new(t);
+        game_search_options_t options = { depth, 0, 0 };
+        game_search_result_t result;
+        double start = now();
+        ok = pool != NULL && game_search(g, 1, &options, pool, &result);
+        double time = now() - start;
+        if (ok) {
+            printf("threads %2u  depth %3u  score %7d%s  %12llu nodes  %8.3f s  %7.3f Mnodes/s\n",
+                   t, result.depth, result.score, result.exact ? " exact" : "",
+                   (unsigned long long) result.nodes, time, result.nodes / time / 1e6);
+        }
+        game_pool_delete(pool);
+        if (t >= threads) { break; }
+    }
+    game_delete(g);
+    return ok;
+}
+
+// Binary logarithm of the number of sub-buckets of one power of two
+#define HIST_SUB_BITS 5
+// Number of buckets of a histogram, enough for any uint64_t
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+/** @brief Histogram of latencies in the style of HdrHistogram, every
+ * power of two is split into 2^HIST_SUB_BITS buckets, so a value is
+ * known with a relative error below 2^-HIST_SUB_BITS
+ * counts - numbers of values in the buckets
+ * total - number of values
+ * sum - sum of values
+ * max - largest value
+*/
+struct histogram {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+};
+typedef struct histogram histogram_t;
+
+/** @brief hist_add.
+ * @param[in,out] h - the histogram
+ * @param[in] value - measured value
+*/
+static inline void hist_add(histogram_t *h, uint64_t value) {
+    uint32_t bucket = (uint32_t) value;
+    if (value >= (1u << HIST_SUB_BITS)) {
+        uint32_t shift = 63 - (uint32_t) __builtin_clzll(value) - HIST_SUB_BITS;
+        bucket = ((shift + 1) << HIST_SUB_BITS) + (uint32_t) (value >> shift)
+                 - (1u << HIST_SUB_BITS);
+    }
+    h->counts[bucket]++;
+    h->total++;
+    h->sum += value;
+    if (value > h->max) { h->max = value; }
+}
+
+/** @brief hist_value.
+ * @param[in] h - the histogram
+ * @param[in] q - quantile from 0 to 1
+ * @return the largest value of the bucket holding the quantile
+*/
+static uint64_t hist_value(histogram_t const *h, double q) {
+    uint64_t rank = (uint64_t) (q * (double) h->total + 0.999999);
+    if (rank == 0) { rank = 1; }
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen < rank) { continue; }
+        if (b < (2u << HIST_SUB_BITS)) { return b; }
+        uint32_t shift = (b >> HIST_SUB_BITS) - 1;
+        uint64_t top = (((uint64_t) (b & ((1u << HIST_SUB_BITS) - 1)) +
+                         (1u << HIST_SUB_BITS) + 1) << shift) - 1;
+        return top < h->max ? top : h->max;
+    }
+    return h->max;
+}
+
+/** @brief Moves of a latency test
+ * name - printed name
+ * players, areas - parameters of the game
+ * moves - the moves
+ * count - number of moves
+*/
+struct scenario {
+    char const * name;
+    uint32_t players;
+    uint32_t areas;
+    move_t * moves;
+    uint64_t count;
+};
+typedef struct scenario scenario_t;
+
+/** @brief serpentine.
+ * Adds moves of player 1 that build one area winding through
+ * columns of rows from @p y0 to @p y1, every move extends it
+ * @param[out] moves - the moves
+ * @param[in,out] count - number of moves
+ * @param[in] size - board's width
+ * @param[in] y0, y1 - first and last row
+*/
+static void serpentine(move_t *moves, uint64_t *count, uint32_t size,
+                       uint32_t y0, uint32_t y1) {
+    for (uint32_t x = 0; x < size; x++) {
+        bool upwards = (x / 2) % 2 == 0;
+        if (x % 2) {
+            // connects the column with the next one at its end
+            moves[(*count)++] = (move_t) { 1, x, upwards ? y1 : y0 };
+            continue;
+        }
+        for (uint32_t i = 0; i <= y1 - y0; i++) {
+            moves[(*count)++] = (move_t) { 1, x, upwards ? y0 + i : y1 - i };
+        }
+    }
+}
+
+/** @brief make_scenarios.
+ * Generates the moves of the latency test
+ * @param[in] size - width and height of the board, at least 3
+ * @param[out] s - the three scenarios
+ * @return @p true if memory could be allocated
+*/
+static bool make_scenarios(uint32_t size, scenario_t s[3]) {
+    uint64_t fields = (uint64_t) size * size;
+    s[0] = (scenario_t) { "random", 2, size, random_moves(3 * fields, size, size, 2, size),
+                          3 * fields };
+    s[1] = (scenario_t) { "serpentine", 1, 2, (move_t *) malloc(fields * sizeof(move_t)), 0 };
+    s[2] = (scenario_t) { "comb", 1, size, (move_t *) malloc(fields * sizeof(move_t)), 0 };
+    if (s[0].moves == NULL || s[1].moves == NULL || s[2].moves == NULL) { return false; }
+
+    // two areas of a quarter of the board each, separated by an empty
+    // row, are merged by the last move, which relabels one of them
+    uint32_t gap = (size - 1) / 2;
+    serpentine(s[1].moves, &s[1].count, size, 0, gap - 1);
+    serpentine(s[1].moves, &s[1].count, size, gap + 1, size - 1);
+    s[1].moves[s[1].count++] = (move_t) { 1, 0, gap };
+
+    // lines in even columns become areas, then the top row merges them
+    // into one growing area, so every second move relabels a whole line
+    for (uint32_t x = 0; x < size; x += 2) {
+        for (uint32_t y = 0; y + 1 < size; y++) {
+            s[2].moves[s[2].count++] = (move_t) { 1, x, y };
+        }
+    }
+    for (uint32_t x = 0; x < size; x++) {
+        s[2].moves[s[2].count++] = (move_t) { 1, x, size - 1 };
+    }
+    return true;
+}
+
+/** @brief bench_latency.
+ * Times every game_move and prints percentiles of the times, which
+ * show merges of large areas hidden by the average. The times include
+ * two reads of the monotonic clock.
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: size, games
+ * @return @p true if every move of the adversarial scenarios was accepted
+*/
+static bool bench_latency(int argc, char *argv[]) {
+    uint32_t size = arg(argc, argv, 0, 1000);
+    uint32_t games = arg(argc, argv, 1, 3);
+    if (size < 3 || !games || (uint64_t) size * size > UINT32_MAX) { return false; }
+
+    scenario_t s[3];
+    histogram_t * h = (histogram_t *) malloc(sizeof(histogram_t));
+    bool ok = h != NULL && make_scenarios(size, s);
+    for (int i = 0; ok && i < 3; i++) {
+        memset(h, 0, sizeof(histogram_t));
+        uint64_t accepted = 0;
+        game_t * g = game_new(size, size, s[i].players, s[i].areas);
+        ok = g != NULL;
+        for (uint32_t k = 0; ok && k < games; k++) {
+            game_reset(g);
+            for (uint64_t m = 0; m < s[i].count; m++) {
+                move_t const * mv = &s[i].moves[m];
+                uint64_t start = now_ns();
+                accepted += game_move(g, mv->player, mv->x, mv->y);
+                hist_add(h, now_ns() - start);
+            }
+        }
+        game_delete(g);
+        // random moves are often rejected, the other ones never
+        if (i > 0 && accepted != s[i].count * games) { ok = false; }
+        printf("%-10s %11llu moves  mean %7.1f  p50 %7llu  p99 %7llu  p99.9 %9llu  "
+               "max %10llu ns%s\n", s[i].name, (unsigned long long) h->total,
+               h->total ? (double) h->sum / (double) h->total : 0.0,
+               (unsigned long long) hist_value(h, 0.5),
+               (unsigned long long) hist_value(h, 0.99),
+               (unsigned long long) hist_value(h, 0.999),
+               (unsigned long long) h->max, ok ? "" : "  MOVE REJECTED");
+    }
+    if (h != NULL) {
+        for (int i = 0; i < 3; i++) { free(s[i].moves); }
+    }
+    free(h);
+    return ok;
+}
+
+// Number of rounds of the fixed mode, the medians are reported
+#define FIXED_ROUNDS 5
+// Limit of rounds of the fixed mode
+#define FIXED_MAX_ROUNDS 64
+
+/** @brief compare_doubles.
+ * @param[in] a - pointer to the first number
+ * @param[in] b - pointer to the second number
+ * @return negative, zero or positive number as for qsort
+*/
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/** @brief median.
+ * Sorts the numbers, so the smallest and the largest are at the ends
+ * @param[in,out] v - the numbers
+ * @param[in] n - number of numbers, positive
+ * @return median of the numbers
+*/
+static double median(double *v, uint32_t n) {
+    qsort(v, n, sizeof(double), compare_doubles);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/** @brief Defines comparison of the generic engine with a fixed one.
+ * @param name - name of the fixed engine
+ * @param size - width and height of its board
+*/
+#define BENCH_FIXED(name, size)                                                \
+static bool bench_##name(uint32_t games, uint32_t rounds) {                    \
+    const uint64_t per_game = 3 * (size) * (size);                             \
+    move_t * moves = random_moves(per_game * games, size, size, 2, size);      \
+    static name##_t fixed;                                                     \
+    char text[((size) + 1) * (size) + 1];                                      \
+    double generic[FIXED_MAX_ROUNDS];                                          \
+    double specialized[FIXED_MAX_ROUNDS];                                      \
+    double ratio[FIXED_MAX_ROUNDS];                                            \
+    if (moves == NULL) { return false; }                                       \
+                                                                               \
+    /* the engines take turns, so both see the same noise */                   \
+    uint64_t accepted = 0;                                                     \
+    uint64_t accepted_fixed = 0;                                               \
+    for (uint32_t r = 0; r < rounds; r++) {                                    \
+        double start = now();                                                  \
+        accepted = 0;                                                          \
+        for (uint32_t i = 0; i < games; i++) {                                 \
+            game_t * g = game_new(size, size, 2, 16);                          \
+            if (g == NULL) { free(moves); return false; }                      \
+            move_t const * m = moves + i * per_game;                           \
+            for (uint64_t k = 0; k < per_game; k++) {                          \
+                accepted += game_move(g, m[k].player, m[k].x, m[k].y);         \
+            }                                                                  \
+            game_delete(g);                                                    \
+        }                                                                      \
+        generic[r] = now() - start;                                            \
+                                                                               \
+        start = now();                                                         \
+        accepted_fixed = 0;                                                    \
+        for (uint32_t i = 0; i < games; i++) {                                 \
+            name##_init(&fixed);                                               \
+            move_t const * m = moves + i * per_game;                           \
+            for (uint64_t k = 0; k < per_game; k++) {                          \
+                accepted_fixed +=                                              \
+                    name##_move(&fixed, m[k].player, m[k].x, m[k].y);          \
+            }                                                                  \
+        }                                                                      \
+        specialized[r] = now() - start;                                        \
+        ratio[r] = generic[r] / specialized[r];                                \
+    }                                                                          \
+                                                                               \
+    /* first games are replayed to compare the results */                      \
+    bool same = accepted == accepted_fixed;                                    \
+    for (uint32_t i = 0; same && i < games && i < 100; i++) {                  \
+        game_t * g = game_new(size, size, 2, 16);                              \
+        if (g == NULL) { free(moves); return false; }                          \
+        name##_init(&fixed);                                                   \
+        move_t const * m = moves + i * per_game;                               \
+        for (uint64_t k = 0; k < per_game; k++) {                              \
+            same = same && game_move(g, m[k].player, m[k].x, m[k].y)           \
+                   == name##_move(&fixed, m[k].player, m[k].x, m[k].y);        \
+        }                                                                      \
+        char * board = game_board(g);                                          \
+        name##_board(&fixed, text);                                            \
+        same = same && board != NULL && strcmp(board, text) == 0;              \
+        for (uint32_t p = 1; p <= 2; p++) {                                    \
+            same = same                                                        \
+                   && game_busy_fields(g, p) == name##_busy_fields(&fixed, p)  \
+                   && game_free_fields(g, p) == name##_free_fields(&fixed, p); \
+        }                                                                      \
+        free(board);                                                           \
+        game_delete(g);                                                        \
+    }                                                                          \
+    free(moves);                                                               \
+                                                                               \
+    double total = (double) per_game * games;                                  \
+    double speedup = median(ratio, rounds);                                    \
+    printf("%ux%u  generic %7.2f Mmoves/s  fixed %7.2f Mmoves/s  x%.2f"        \
+           "  (x%.2f..x%.2f in %u rounds)%s\n",                                \
+           size, size, total / median(generic, rounds) / 1e6,                  \
+           total / median(specialized, rounds) / 1e6, speedup,                 \
+           ratio[0], ratio[rounds - 1], rounds,                                \
+           same ? "" : "  RESULTS DIFFER");                                    \
+    return same;                                                               \
+}
+
+BENCH_FIXED(game19, 19)
+BENCH_FIXED(game32, 32)
+
+/** @brief bench_fixed.
+ * Compares the generic engine with specialized ones
+ * @param[in] argc - number of mode's arguments
+ * @param[in] argv - mode's arguments: number of games and rounds
+ * @return @p true if the engines gave the same results
+*/
+static bool bench_fixed(int argc, char *argv[]) {
+    uint32_t games = arg(argc, argv, 0, 20000);
+    uint32_t rounds = arg(argc, argv, 1, FIXED_ROUNDS);
+    if (games == 0 || rounds == 0 || rounds > FIXED_MAX_ROUNDS) { return false; }
+    return bench_game19(games, rounds) & bench_game32(games / 2 + 1, rounds);
+}
+
+/** @brief Representation of benchmark's mode
+ * name - name given in the command line
+ * run - the benchmark
+*/
+struct bench_mode {
+    const char * name;
+    bool (*run)(int argc, char *argv[]);
+};
+typedef struct bench_mode bench_mode_t;
+
+// Available modes
+static const bench_mode_t modes[] = {
+    { "random", bench_random },
+    { "fixed", bench_fixed },
+    { "churn", bench_churn },
+    { "board", bench_board },
+    { "export", bench_export },
+    { "pages", bench_pages },
+    { "replay", bench_replay },
+    { "rebuild", bench_rebuild },
+    { "planes", bench_planes },
+    { "search", bench_search },
+    { "latency", bench_latency },
+};
+
+/** @brief Runs a benchmark.
+ * @return Zero on success and 1 on error
+ */
+int main(int argc, char *argv[]) {
+    for (size_t i = 0; argc > 1 && i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(argv[1], modes[i].name) == 0) {
+            return modes[i].run(argc - 2, argv + 2) ? 0 : 1;
+        }
+    }
+    fprintf(stderr, "usage: %s mode [arguments]\nmodes:", argv[0]);
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        fprintf(stderr, " %s", modes[i].name);
+    }
+    fprintf(stderr, "\n");
+    return 1;
+}
@@ -6,6 +6,11 @@
  * @date 2023
  */
 
+/**
+ * Funkcja fileno pochodzi z POSIX.
+ */
+#define _POSIX_C_SOURCE 200809L
+
 /**
  * W tym pliku nawet w wersji release chcemy korzystać z asercji.
  */
@@ -14,6 +19,7 @@
 #endif
 
 #include "game.h"
+#include "game_search.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -79,12 +85,223 @@ int main() {
   assert(game_busy_fields(g, 2) == 4);
   assert(game_free_fields(g, 2) == 91);
 
+  game_area_t areas[4];
+  assert(game_areas(g, 1, NULL, 0) == 3);
+  assert(game_areas(g, 2, areas, 4) == 2);
+  assert(game_areas(g, 1, areas, 4) == 3);
+  for (int i = 0; i < 3; i++) {
+    if (areas[i].size == 3) {
+      assert(areas[i].perimeter == 3);
+      assert(areas[i].min_x == 0 && areas[i].max_x == 0);
+      assert(areas[i].min_y == 0 && areas[i].max_y == 2);
+    }
+  }
+
+  uint8_t mask[3];
+  assert(game_can_move(g, 1, 1, 0));
+  assert(!game_can_move(g, 1, 7, 7));
+  assert(!game_can_move(g, 1, 0, 0));
+  assert(game_can_move_mask(g, 1, 0, 0, 3, 3, mask) == 2);
+  assert(mask[0] == 0x02 && mask[1] == 0x00 && mask[2] == 0x02);
+
+  game_stats_t stats;
+  if (game_stats(g, &stats)) {
+    assert(stats.phase[GAME_STATS_MOVE].count == 9);
+    assert(stats.rejected[GAME_MOVE_AREAS] == 2);
+    assert(stats.rejected[GAME_MOVE_OCCUPIED] == 1);
+    assert(stats.merges == 1 && stats.merged_fields == 1);
+  }
+
   char *p = game_board(g);
   assert(p);
   assert(strcmp(p, board) == 0);
   printf(p);
   free(p);
 
+  game_pool_t *pool = game_pool_new(3);
+  assert(pool);
+  p = game_board_parallel(g, pool);
+  assert(p);
+  assert(strcmp(p, board) == 0);
+  free(p);
+  game_pool_delete(pool);
+
+  FILE *file = tmpfile();
+  assert(file);
+  assert(game_board_write(g, fileno(file)));
+  char written[sizeof(board)];
+  rewind(file);
+  assert(fread(written, 1, sizeof(written), file) == strlen(board));
+  assert(memcmp(written, board, strlen(board)) == 0);
+  fclose(file);
+
+  for (game_format_t f = GAME_FORMAT_RLE; f <= GAME_FORMAT_PACKED; f++) {
+    size_t size;
+    void *data = game_export(g, f, &size);
+    assert(data);
+    game_t *copy = game_import(data, size);
+    free(data);
+    assert(copy);
+    p = game_board(copy);
+    assert(p);
+    assert(strcmp(p, board) == 0);
+    free(p);
+    assert(game_busy_fields(copy, 1) == game_busy_fields(g, 1));
+    assert(game_free_fields(copy, 2) == game_free_fields(g, 2));
+    game_delete(copy);
+  }
+
+  game_move_info_t info;
+  assert(game_move_ex(NULL, 1, 0, 0, &info) == GAME_MOVE_NO_GAME);
+  assert(game_move_ex(g, 3, 7, 7, &info) == GAME_MOVE_PLAYER);
+  assert(game_move_ex(g, 1, 10, 0, &info) == GAME_MOVE_RANGE);
+  assert(game_move_ex(g, 1, 0, 0, &info) == GAME_MOVE_OCCUPIED);
+  assert(game_move_ex(g, 1, 7, 7, &info) == GAME_MOVE_AREAS);
+  assert(game_move_ex(g, 2, 1, 0, &info) == GAME_MOVE_OK);
+  assert(info.boundary == -1 && info.areas == 0);
+  assert(info.merged == 0 && info.strangers == 1);
+
+  game_delete(g);
+
+  size_t size = game_footprint(5, 5, 2, 2);
+  assert(size > 0);
+  assert(game_footprint(0, 5, 2, 2) == 0);
+  void *memory = malloc(size);
+  assert(memory);
+  assert(game_new_in(memory, size - 1, 5, 5, 2, 2) == NULL && errno == ENOMEM);
+  g = game_new_in(memory, size, 5, 5, 2, 2);
+  assert(g);
+  assert(game_move(g, 1, 0, 0));
+  assert(game_move(g, 2, 4, 4));
+  assert(game_busy_fields(g, 1) == 1);
+  game_reset(g);
+  assert(game_busy_fields(g, 1) == 0);
+  assert(game_free_fields(g, 2) == 25);
+  assert(game_move(g, 2, 0, 0));
+  game_delete(g);
+  free(memory);
+
+  game_options_t options = { 5, 5, 2, 2, GAME_PAGES_DEFAULT, GAME_NUMA_DEFAULT, 0 };
+  g = game_new_ex(&options);
+  assert(g);
+  assert(game_move(g, 1, 4, 0));
+  game_delete(g);
+  options.numa = GAME_NUMA_BIND;
+  assert(game_new_ex(&options) == NULL);
+
+  game_cache_t *cache = game_cache_new();
+  assert(cache);
+  g = game_cache_get(cache, 5, 5, 2, 2);
+  assert(g);
+  assert(game_move(g, 1, 2, 2));
+  game_t *used = g;
+  game_cache_put(cache, g);
+  g = game_cache_get(cache, 5, 5, 2, 2);
+  assert(g == used);
+  assert(game_busy_fields(g, 1) == 0);
+  game_cache_put(cache, g);
+  game_cache_delete(cache);
+
+  g = game_new(5, 5, 2, 1);
+  assert(g);
+  assert(!game_set_boundary(NULL, GAME_BOUNDARY_DEFERRED, NULL));
+  assert(game_set_boundary(g, GAME_BOUNDARY_DEFERRED, NULL));
+  assert(game_move(g, 1, 2, 2));
+  assert(game_move(g, 1, 2, 3));
+  assert(game_move(g, 2, 3, 2));
+  assert(game_free_fields(g, 1) == 5);
+  assert(game_free_fields(g, 2) == 3);
+  game_area_t area;
+  assert(game_areas(g, 1, &area, 1) == 1 && area.perimeter == 5);
+  assert(game_set_boundary(g, GAME_BOUNDARY_EXACT, NULL));
+  assert(game_move(g, 2, 4, 2));
+  assert(game_free_fields(g, 2) == 4);
+  assert(!game_rebuild(NULL, NULL));
+  assert(game_rebuild(g, NULL));
+  assert(game_free_fields(g, 1) == 5);
+  assert(game_free_fields(g, 2) == 4);
+  assert(game_busy_fields(g, 2) == 2);
+  assert(game_areas(g, 2, &area, 1) == 1 && area.size == 2);
+
+  uint8_t planes[4 * 5 * 5];
+  assert(game_feature_planes(g, planes, GAME_LAYOUT_NCHW, GAME_PLANES_U8));
+  assert(planes[2 * 5 + 2] == 1 && planes[25 + 2 * 5 + 3] == 1);
+  assert(planes[50 + 2 * 5 + 1] == 1 && planes[50] == 0);
+  float cells[4 * 5 * 5];
+  assert(game_feature_planes(g, cells, GAME_LAYOUT_NHWC, GAME_PLANES_F32));
+  assert(cells[(2 * 5 + 3) * 4 + 1] == 1.0f && cells[(2 * 5 + 3) * 4] == 0.0f);
+  assert(!game_feature_planes(NULL, planes, GAME_LAYOUT_NCHW, GAME_PLANES_U8));
+  assert(game_undo(g));
+  assert(game_busy_fields(g, 2) == 1);
+  assert(game_free_fields(g, 2) == 3);
+  assert(game_can_move(g, 2, 4, 2));
+  assert(!game_undo(NULL));
+  game_delete(g);
+
+  g = game_new(3, 3, 2, 1);
+  assert(g);
+  game_search_result_t result;
+  assert(game_search(g, 1, NULL, NULL, &result));
+  assert(result.exact && result.score == 3 * GAME_SEARCH_FIELD);
+  assert(!result.pass && result.x == 1 && result.y == 1);
+  assert(game_busy_fields(g, 1) == 0 && game_busy_fields(g, 2) == 0);
+  game_delete(g);
+
+  g = game_new(3, 1, 2, 1);
+  assert(g);
+  assert(!game_is_over(g));
+  assert(game_next_player_with_moves(g, 0) == 1);
+  assert(game_move(g, 1, 1, 0));
+  assert(game_move(g, 2, 0, 0));
+  assert(game_next_player_with_moves(g, 1) == 1);
+  assert(!game_is_over(g));
+  assert(game_undo(g));
+  assert(game_next_player_with_moves(g, 1) == 2);
+  assert(game_move(g, 2, 0, 0));
+  assert(game_move(g, 1, 2, 0));
+  assert(game_is_over(g));
+  assert(game_next_player_with_moves(g, 1) == 0);
+  uint64_t scores[2];
+  assert(game_scores(g, scores) && scores[0] == 2 && scores[1] == 1);
+  game_delete(g);
+
+  g = game_new(3, 1, 2, 1);
+  assert(g);
+  assert(game_current_player(g) == 1);
+  assert(game_play(g, 1, 0));
+  assert(game_current_player(g) == 2);
+  assert(!game_play(g, 1, 0));
+  assert(game_play(g, 0, 0));
+  assert(game_current_player(g) == 1);
+  assert(game_pass(g));
+  assert(game_current_player(g) == 1);
+  assert(game_undo(g));
+  assert(game_current_player(g) == 2);
+  assert(game_play(g, 0, 0));
+  assert(game_play(g, 2, 0));
+  assert(game_current_player(g) == 0);
+  assert(!game_play(g, 0, 0) && !game_pass(g));
+  game_delete(g);
+
+  g = game_new(3, 1, 2, 1);
+  assert(g);
+  // game_move does not pass the turn, so neither does its undo
+  assert(game_move(g, 2, 0, 0));
+  assert(game_undo(g));
+  assert(game_current_player(g) == 1);
+  game_delete(g);
+
+  g = game_new(3, 5, 1, 2);
+  assert(g);
+  // two U-shaped areas joined by the field between them
+  const uint32_t u[10][2] = { {0, 1}, {0, 0}, {1, 0}, {2, 0}, {2, 1},
+                              {0, 3}, {0, 4}, {1, 4}, {2, 4}, {2, 3} };
+  for (int i = 0; i < 10; i++) { assert(game_move(g, 1, u[i][0], u[i][1])); }
+  assert(game_areas(g, 1, NULL, 0) == 2);
+  assert(game_move(g, 1, 0, 2));
+  assert(game_areas(g, 1, &area, 1) == 1 && area.size == 11);
+  assert(game_undo(g));
+  assert(game_areas(g, 1, &area, 1) == 2 && area.size == 5);
   game_delete(g);
   return 0;
 }
@@ -0,0 +1,241 @@
+/** @file
+ * Engine of the game specialized for fixed parameters
+ *
+ * This file is a template: it has no include guard and every inclusion
+ * defines one engine with parameters given by macros, which are
+ * undefined at the end of the file:
+ *
+ *     #define GAME_FIXED_NAME    game19
+ *     #define GAME_FIXED_WIDTH   19
+ *     #define GAME_FIXED_HEIGHT  19
+ *     #define GAME_FIXED_PLAYERS 2
+ *     #define GAME_FIXED_AREAS   16
+ *     #include "game_fixed.h"
+ *
+ * defines type game19_t and static functions game19_init, game19_move,
+ * game19_busy_fields, game19_free_fields and game19_board. They follow
+ * the rules of game.h, but the state is a single structure without
+ * allocations. The board has a border of two fields that never belong
+ * to any player, so neighbours are read at constant offsets without
+ * checking coordinates.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#if !defined(GAME_FIXED_NAME) || !defined(GAME_FIXED_WIDTH) || \
+    !defined(GAME_FIXED_HEIGHT) || !defined(GAME_FIXED_PLAYERS) || \
+    !defined(GAME_FIXED_AREAS)
+#error "game_fixed.h needs GAME_FIXED_NAME, _WIDTH, _HEIGHT, _PLAYERS and _AREAS"
+#endif
+
+#if GAME_FIXED_PLAYERS < 1 || GAME_FIXED_PLAYERS > 35 || \
+    GAME_FIXED_WIDTH < 1 || GAME_FIXED_HEIGHT < 1 || GAME_FIXED_AREAS < 1
+#error "wrong parameters of game_fixed.h"
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define GF_CAT_(a, b) a##_##b
+#define GF_CAT(a, b) GF_CAT_(a, b)
+// Name of the instance's function or type
+#define GF(fn) GF_CAT(GAME_FIXED_NAME, fn)
+
+// Distance between columns
+#define GF_S (GAME_FIXED_HEIGHT + 4)
+// Number of fields with the border
+#define GF_N ((GAME_FIXED_WIDTH + 4) * GF_S)
+// Number of fields of the board
+#define GF_CELLS (GAME_FIXED_WIDTH * GAME_FIXED_HEIGHT)
+// Owner of the border's fields
+#define GF_BORDER 0xFF
+
+/** @brief State of the specialized game
+ * owner - player on the field, 0 for free and GF_BORDER for border fields
+ * id - area of the field
+ * area_size - number of fields in the area
+ * stack - fields waiting for relabeling during merge
+ * areas_used - last used id, ids are not reused
+ * taken - number of busy fields
+ * boundary, busy_areas, busy - player's counters, indexed by owner
+*/
+typedef struct GF(s) {
+    uint8_t owner[GF_N];
+    uint32_t id[GF_N];
+    uint32_t area_size[GF_CELLS + 1];
+    uint32_t stack[GF_CELLS];
+    uint32_t areas_used;
+    uint32_t taken;
+    uint64_t boundary[256];
+    uint32_t busy_areas[256];
+    uint64_t busy[256];
+} GF(t);
+
+/** @brief Sets the initial state of the game.
+ * @param[out] g - the game
+*/
+static inline void GF(init)(GF(t) *g) {
+    memset(g->owner, GF_BORDER, sizeof(g->owner));
+    for (uint32_t x = 0; x < GAME_FIXED_WIDTH; x++) {
+        memset(&g->owner[(x + 2) * GF_S + 2], 0, GAME_FIXED_HEIGHT);
+    }
+    g->areas_used = 0;
+    g->taken = 0;
+    g->area_size[0] = 0;
+    for (uint32_t p = 0; p <= GAME_FIXED_PLAYERS; p++) {
+        g->boundary[p] = 0;
+        g->busy_areas[p] = 0;
+        g->busy[p] = 0;
+    }
+}
+
+/** @brief Relabels the area containing field @p from.
+ * @param[in,out] g - the game
+ * @param[in] p - owner of the area
+ * @param[in] id - new id
+ * @param[in] from - field of the area
+*/
+static inline void GF(relabel)(GF(t) *g, uint8_t p, uint32_t id, uint32_t from) {
+    uint32_t top = 0;
+    g->id[from] = id;
+    g->stack[top++] = from;
+    while (top) {
+        uint32_t f = g->stack[--top];
+        const uint32_t next[4] = { f - GF_S, f + GF_S, f - 1, f + 1 };
+        for (int k = 0; k < 4; k++) {
+            uint32_t m = next[k];
+            if (g->owner[m] == p && g->id[m] != id) {
+                g->id[m] = id;
+                g->stack[top++] = m;
+            }
+        }
+    }
+}
+
+/** @brief Makes a move, see @ref game_move.
+ * @param[in,out] g - the game
+ * @param[in] player - player's number
+ * @param[in] x - column's number
+ * @param[in] y - row's number
+ * @return @p true if the move was made
+*/
+static inline bool GF(move)(GF(t) *g, uint32_t player, uint32_t x, uint32_t y) {
+    if (player - 1 >= GAME_FIXED_PLAYERS || x >= GAME_FIXED_WIDTH ||
+        y >= GAME_FIXED_HEIGHT) {
+        return false;
+    }
+    const uint32_t c = (x + 2) * GF_S + y + 2;
+    uint8_t * const o = g->owner;
+    if (o[c]) { return false; }
+
+    const uint8_t p = (uint8_t) player;
+    const uint32_t n[4] = { c - GF_S, c + GF_S, c - 1, c + 1 };
+    const uint8_t q0 = o[n[0]], q1 = o[n[1]], q2 = o[n[2]], q3 = o[n[3]];
+    const uint32_t own0 = q0 == p, own1 = q1 == p, own2 = q2 == p, own3 = q3 == p;
+    const uint32_t around = own0 + own1 + own2 + own3;
+    if (!around && g->busy_areas[p] == GAME_FIXED_AREAS) { return false; }
+
+    // free neighbours that already touch the player
+    const uint32_t free0 = q0 == 0, free1 = q1 == 0, free2 = q2 == 0, free3 = q3 == 0;
+    const uint32_t common =
+        (free0 & ((o[c - 2 * GF_S] == p) | (o[c - GF_S - 1] == p) | (o[c - GF_S + 1] == p))) +
+        (free1 & ((o[c + 2 * GF_S] == p) | (o[c + GF_S - 1] == p) | (o[c + GF_S + 1] == p))) +
+        (free2 & ((o[c - 2] == p) | (o[c - 1 - GF_S] == p) | (o[c - 1 + GF_S] == p))) +
+        (free3 & ((o[c + 2] == p) | (o[c + 1 - GF_S] == p) | (o[c + 1 + GF_S] == p)));
+    g->boundary[p] += free0 + free1 + free2 + free3;
+    g->boundary[p] -= common + (around != 0);
+
+    // other players lose the field once each, 0 and the border are skipped
+    g->boundary[q0] -= (q0 != p) & (q0 != 0) & (q0 != GF_BORDER);
+    g->boundary[q1] -= (q1 != p) & (q1 != 0) & (q1 != GF_BORDER) & (q1 != q0);
+    g->boundary[q2] -= (q2 != p) & (q2 != 0) & (q2 != GF_BORDER) & (q2 != q0) &
+                       (q2 != q1);
+    g->boundary[q3] -= (q3 != p) & (q3 != 0) & (q3 != GF_BORDER) & (q3 != q0) &
+                       (q3 != q1) & (q3 != q2);
+
+    uint32_t id;
+    if (!around) {
+        id = ++g->areas_used;
+        g->area_size[id] = 0;
+        g->busy_areas[p]++;
+    } else {
+        const uint32_t ids[4] = {
+            own0 ? g->id[n[0]] : 0, own1 ? g->id[n[1]] : 0,
+            own2 ? g->id[n[2]] : 0, own3 ? g->id[n[3]] : 0
+        };
+        // the largest area keeps its id
+        id = ids[0];
+        for (int k = 1; k < 4; k++) {
+            if (g->area_size[ids[k]] > g->area_size[id]) { id = ids[k]; }
+        }
+        for (int k = 0; k < 4; k++) {
+            uint32_t other = ids[k];
+            if (!other || other == id) { continue; }
+            if ((k > 0 && ids[0] == other) || (k > 1 && ids[1] == other) ||
+                (k > 2 && ids[2] == other)) {
+                continue;
+            }
+            g->area_size[id] += g->area_size[other];
+            g->busy_areas[p]--;
+            GF(relabel)(g, p, id, n[k]);
+        }
+    }
+
+    o[c] = p;
+    g->id[c] = id;
+    g->area_size[id]++;
+    g->busy[p]++;
+    g->taken++;
+    return true;
+}
+
+/** @brief See @ref game_busy_fields.
+ * @param[in] g - the game
+ * @param[in] player - player's number
+ * @return number of player's fields
+*/
+static inline uint64_t GF(busy_fields)(GF(t) const *g, uint32_t player) {
+    return player - 1 < GAME_FIXED_PLAYERS ? g->busy[player] : 0;
+}
+
+/** @brief See @ref game_free_fields.
+ * @param[in] g - the game
+ * @param[in] player - player's number
+ * @return number of fields the player can take
+*/
+static inline uint64_t GF(free_fields)(GF(t) const *g, uint32_t player) {
+    if (player - 1 >= GAME_FIXED_PLAYERS) { return 0; }
+    return g->busy_areas[player] == GAME_FIXED_AREAS
+           ? g->boundary[player] : (uint64_t) (GF_CELLS - g->taken);
+}
+
+/** @brief See @ref game_board.
+ * @param[in] g - the game
+ * @param[out] buf - buffer of (width + 1) * height + 1 bytes
+*/
+static inline void GF(board)(GF(t) const *g, char *buf) {
+    for (uint32_t y = GAME_FIXED_HEIGHT; y-- > 0;) {
+        for (uint32_t x = 0; x < GAME_FIXED_WIDTH; x++) {
+            uint8_t p = g->owner[(x + 2) * GF_S + y + 2];
+            *buf++ = p == 0 ? '.' : p <= 9 ? (char) ('0' + p) : (char) ('a' + p - 10);
+        }
+        *buf++ = '\n';
+    }
+    *buf = '\0';
+}
+
+#undef GF_BORDER
+#undef GF_CELLS
+#undef GF_N
+#undef GF_S
+#undef GF
+#undef GF_CAT
+#undef GF_CAT_
+#undef GAME_FIXED_NAME
+#undef GAME_FIXED_WIDTH
+#undef GAME_FIXED_HEIGHT
+#undef GAME_FIXED_PLAYERS
+#undef GAME_FIXED_AREAS
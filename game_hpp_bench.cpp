@@ -0,0 +1,119 @@
+/** @file
+ * Benchmark of the C++ interface
+ *
+ * Plays the same random moves through game.h and through
+ * game.hpp and compares the time per move.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#include "game.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Board's size
+constexpr uint32_t SIZE = 512;
+// Number of players
+constexpr uint32_t PLAYERS = 4;
+// Number of moves in one round
+constexpr std::size_t MOVES = 2000000;
+// Number of rounds, the best one is reported
+constexpr int ROUNDS = 5;
+
+/** @brief Pre-generated move */
+struct Move {
+    uint32_t player;
+    uint32_t x;
+    uint32_t y;
+};
+
+/** @brief Random moves, xorshift64 */
+std::vector<Move> random_moves() {
+    std::vector<Move> moves(MOVES);
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    for (Move & m : moves) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        m.player = (uint32_t) (state % PLAYERS) + 1;
+        m.x = (uint32_t) ((state >> 16) % SIZE);
+        m.y = (uint32_t) ((state >> 40) % SIZE);
+    }
+    return moves;
+}
+
+/** @brief Best time of a round in nanoseconds per move */
+template <class Round> double measure(Round round, uint64_t & accepted) {
+    double best = 1e30;
+    for (int r = 0; r < ROUNDS; r++) {
+        auto start = std::chrono::steady_clock::now();
+        accepted = round();
+        std::chrono::duration<double, std::nano> d =
+            std::chrono::steady_clock::now() - start;
+        if (d.count() / MOVES < best) { best = d.count() / MOVES; }
+    }
+    return best;
+}
+
+} // namespace
+
+/** @brief Runs the benchmark.
+ * @return Zero if both interfaces gave the same game
+ */
+int main() {
+    using game_engine::Game;
+    std::vector<Move> const moves = random_moves();
+    uint64_t accepted_c = 0;
+    uint64_t accepted_cpp = 0;
+    uint64_t accepted_try = 0;
+
+    double c = measure([&] {
+        game_t * g = game_new(SIZE, SIZE, PLAYERS, SIZE);
+        uint64_t n = 0;
+        for (Move const & m : moves) { n += game_move(g, m.player, m.x, m.y); }
+        game_delete(g);
+        return n;
+    }, accepted_c);
+
+    double cpp = measure([&] {
+        Game g = *Game::create(SIZE, SIZE, PLAYERS, SIZE);
+        uint64_t n = 0;
+        for (Move const & m : moves) { n += g.move(m.player, m.x, m.y); }
+        return n;
+    }, accepted_cpp);
+
+    double tried = measure([&] {
+        Game g = *Game::create(SIZE, SIZE, PLAYERS, SIZE);
+        uint64_t n = 0;
+        for (Move const & m : moves) { n += g.try_move(m.player, m.x, m.y).has_value(); }
+        return n;
+    }, accepted_try);
+
+    std::printf("game_move        %6.2f ns/move\n", c);
+    std::printf("Game::move       %6.2f ns/move\n", cpp);
+    std::printf("Game::try_move   %6.2f ns/move\n", tried);
+
+    // both interfaces must lead to the same board
+    game_t * raw = game_new(SIZE, SIZE, PLAYERS, SIZE);
+    Game g = *Game::create(SIZE, SIZE, PLAYERS, SIZE);
+    for (Move const & m : moves) {
+        game_move(raw, m.player, m.x, m.y);
+        g.move(m.player, m.x, m.y);
+    }
+    char * text = game_board(raw);
+    bool same = text != nullptr && g.board().text() == std::string_view(text);
+    std::free(text);
+    game_delete(raw);
+
+    if (!same || accepted_c != accepted_cpp || accepted_c != accepted_try) {
+        std::printf("results differ\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,366 @@
+/** @file
+ * Load generator for the game server
+ *
+ * Opens connections to @ref game_server.c, creates one game per
+ * connection and sends pipelined batches of random moves, reading
+ * replies while the batch is being sent.
+ * Reports the number of moves per second.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// Longest MOVE request
+#define MAX_REQUEST 64
+// Limit of connections
+#define MAX_CONNS 256
+// Size of a connection's output buffer
+#define OUT_CHUNK 16384
+
+/** @brief Representation of client's connection
+ * fd - socket
+ * game - id of the game created by the connection
+ * to_send - number of moves of the batch not written to @p out yet
+ * pending - number of written moves whose replies were not received yet
+ * state - state of the connection's random generator
+ * line_start - whether the next received byte begins a reply
+ * out - requests that were not sent yet
+ * out_len - number of bytes in @p out
+ * out_sent - number of bytes of @p out already sent
+*/
+struct conn {
+    int fd;
+    uint32_t game;
+    uint64_t to_send;
+    uint64_t pending;
+    uint64_t state;
+    bool line_start;
+    char out[OUT_CHUNK];
+    size_t out_len;
+    size_t out_sent;
+};
+typedef struct conn conn_t;
+
+/** @brief Options of the run
+ * path - Unix socket or NULL for TCP
+ * port - TCP port
+ * moves - number of moves per connection
+ * batch - number of pipelined moves
+ * size - board's width and height
+ * players - number of players
+ * conns - number of connections
+*/
+struct options {
+    const char * path;
+    uint16_t port;
+    uint64_t moves;
+    uint32_t batch;
+    uint32_t size;
+    uint32_t players;
+    uint32_t conns;
+};
+typedef struct options options_t;
+
+/** @brief next_random.
+ * xorshift64 generator
+ * @param[in,out] state - generator's state
+ * @return next number
+*/
+static uint64_t next_random(uint64_t * state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/** @brief connect_server.
+ * @param[in] opt - options of the run
+ * @return connected socket or -1
+*/
+static int connect_server(options_t const * opt) {
+    int fd;
+    if (opt->path != NULL) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, opt->path, sizeof(addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) { return -1; }
+        if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(opt->port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) { return -1; }
+        if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+/** @brief send_all.
+ * @param[in] fd - socket
+ * @param[in] data - bytes to send
+ * @param[in] len - number of bytes
+ * @return @p true if everything was sent
+*/
+static bool send_all(int fd, const char * data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        data += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+/** @brief receive_line.
+ * Reads one reply without the new line, byte by byte, so that
+ * nothing after the reply is consumed
+ * @param[in] fd - socket
+ * @param[out] line - the reply ended with a null character
+ * @param[in] cap - size of @p line
+ * @return @p true on success and @p false if the connection was closed
+ * or the reply does not fit in @p line
+*/
+static bool receive_line(int fd, char * line, size_t cap) {
+    size_t len = 0;
+    for (;;) {
+        char ch;
+        ssize_t n = recv(fd, &ch, 1, 0);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        if (ch == '\n') { break; }
+        if (len + 1 == cap) { return false; }
+        line[len++] = ch;
+    }
+    line[len] = '\0';
+    return true;
+}
+
+/** @brief parse_id.
+ * @param[in] line - reply to NEW request
+ * @param[out] id - id of the game
+ * @return @p true if the reply is a number fitting in 32 bits
+*/
+static bool parse_id(const char * line, uint32_t * id) {
+    uint64_t value = 0;
+    if (*line == '\0') { return false; }
+    for (; *line; line++) {
+        if (*line < '0' || *line > '9') { return false; }
+        value = value * 10 + (uint64_t) (*line - '0');
+        if (value > UINT32_MAX) { return false; }
+    }
+    *id = (uint32_t) value;
+    return true;
+}
+
+/** @brief fill_output.
+ * Writes next random moves to the empty output buffer
+ * @param[in,out] c - connection
+ * @param[in] opt - options of the run
+*/
+static void fill_output(conn_t * c, options_t const * opt) {
+    if (c->out_sent < c->out_len) { return; }
+    c->out_len = c->out_sent = 0;
+    while (c->to_send > 0 && c->out_len + MAX_REQUEST <= OUT_CHUNK) {
+        uint64_t r = next_random(&c->state);
+        c->out_len += (size_t) snprintf(c->out + c->out_len, MAX_REQUEST,
+                                        "M %u %u %u %u\n", c->game,
+                                        (uint32_t) (r % opt->players) + 1,
+                                        (uint32_t) ((r >> 16) % opt->size),
+                                        (uint32_t) ((r >> 40) % opt->size));
+        c->to_send--;
+        c->pending++;
+    }
+}
+
+/** @brief send_ready.
+ * Sends as much of the output buffer as the socket accepts
+ * @param[in,out] c - connection
+ * @return @p false if the connection failed
+*/
+static bool send_ready(conn_t * c) {
+    while (c->out_sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { return true; }
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        c->out_sent += (size_t) n;
+    }
+    return true;
+}
+
+/** @brief receive_ready.
+ * Reads available replies to MOVE requests
+ * @param[in,out] c - connection
+ * @param[in,out] accepted - number of replies "1"
+ * @return @p false if the connection was closed
+*/
+static bool receive_ready(conn_t * c, uint64_t * accepted) {
+    char buf[65536];
+    ssize_t n;
+    do {
+        n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) { return errno == EAGAIN || errno == EWOULDBLOCK; }
+    if (n == 0) { return false; }
+    for (ssize_t i = 0; i < n; i++) {
+        if (c->line_start && buf[i] == '1') { (*accepted)++; }
+        c->line_start = buf[i] == '\n';
+        if (c->line_start) { c->pending--; }
+    }
+    return true;
+}
+
+/** @brief elapsed.
+ * @param[in] from - start of measurement
+ * @return seconds since @p from
+*/
+static double elapsed(struct timespec const * from) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - from->tv_sec)
+           + (double) (now.tv_nsec - from->tv_nsec) / 1e9;
+}
+
+/** @brief Runs the load generator.
+ * Usage: game_loadgen [-p port | -u path] [-n moves] [-b batch]
+ * [-s size] [-k players] [-c connections]
+ * @return Zero on success and 1 on error
+ */
+int main(int argc, char *argv[]) {
+    options_t opt = { NULL, 5555, 1000000, 1000, 1000, 2, 1 };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char * value = argv[i + 1];
+        if (!strcmp(argv[i], "-u")) { opt.path = value; }
+        else if (!strcmp(argv[i], "-p")) { opt.port = (uint16_t) atoi(value); }
+        else if (!strcmp(argv[i], "-n")) { opt.moves = strtoull(value, NULL, 10); }
+        else if (!strcmp(argv[i], "-b")) { opt.batch = (uint32_t) atoi(value); }
+        else if (!strcmp(argv[i], "-s")) { opt.size = (uint32_t) atoi(value); }
+        else if (!strcmp(argv[i], "-k")) { opt.players = (uint32_t) atoi(value); }
+        else if (!strcmp(argv[i], "-c")) { opt.conns = (uint32_t) atoi(value); }
+    }
+    if (!opt.batch || !opt.size || !opt.players || !opt.conns
+        || opt.conns > MAX_CONNS) {
+        fprintf(stderr, "game_loadgen: wrong options\n");
+        return 1;
+    }
+
+    conn_t * conns = (conn_t *) calloc(opt.conns, sizeof(conn_t));
+    struct pollfd * fds = (struct pollfd *) calloc(opt.conns, sizeof(struct pollfd));
+    if (conns == NULL || fds == NULL) {
+        fprintf(stderr, "game_loadgen: out of memory\n");
+        return 1;
+    }
+    char request[MAX_REQUEST];
+    for (uint32_t i = 0; i < opt.conns; i++) {
+        conns[i].fd = connect_server(&opt);
+        if (conns[i].fd < 0) {
+            perror("game_loadgen");
+            return 1;
+        }
+        int len = snprintf(request, sizeof(request), "NEW %u %u %u %u\n",
+                           opt.size, opt.size, opt.players, opt.size * opt.size);
+        if (!send_all(conns[i].fd, request, (size_t) len)
+            || !receive_line(conns[i].fd, request, sizeof(request))
+            || !parse_id(request, &conns[i].game)) {
+            fprintf(stderr, "game_loadgen: NEW failed\n");
+            return 1;
+        }
+        conns[i].state = 0x9E3779B97F4A7C15u * (i + 1);
+        conns[i].line_start = true;
+        fds[i].fd = conns[i].fd;
+    }
+
+    uint64_t accepted = 0;
+    uint64_t sent = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (sent < opt.moves) {
+        uint64_t count = opt.moves - sent < opt.batch ? opt.moves - sent : opt.batch;
+        for (uint32_t i = 0; i < opt.conns; i++) { conns[i].to_send = count; }
+        // replies are read while the batch is sent, otherwise both
+        // sides could block on full socket buffers
+        for (;;) {
+            bool busy = false;
+            for (uint32_t i = 0; i < opt.conns; i++) {
+                fill_output(&conns[i], &opt);
+                fds[i].events = 0;
+                if (conns[i].out_sent < conns[i].out_len) { fds[i].events |= POLLOUT; }
+                if (conns[i].pending > 0) { fds[i].events |= POLLIN; }
+                busy |= fds[i].events != 0;
+            }
+            if (!busy) { break; }
+            if (poll(fds, opt.conns, -1) < 0) {
+                if (errno == EINTR) { continue; }
+                perror("game_loadgen");
+                return 1;
+            }
+            for (uint32_t i = 0; i < opt.conns; i++) {
+                short revents = fds[i].revents;
+                if ((revents & (POLLIN | POLLHUP | POLLERR))
+                    && !receive_ready(&conns[i], &accepted)) {
+                    fprintf(stderr, "game_loadgen: connection closed\n");
+                    return 1;
+                }
+                if ((revents & POLLOUT) && !send_ready(&conns[i])) {
+                    perror("game_loadgen");
+                    return 1;
+                }
+            }
+        }
+        sent += count;
+    }
+
+    double seconds = elapsed(&start);
+    uint64_t total = sent * opt.conns;
+    printf("moves: %llu (accepted %llu)\n", (unsigned long long) total,
+           (unsigned long long) accepted);
+    printf("time: %.3f s\n", seconds);
+    printf("moves/sec: %.0f\n", (double) total / seconds);
+
+    for (uint32_t i = 0; i < opt.conns; i++) {
+        int len = snprintf(request, sizeof(request), "DEL %u\n", conns[i].game);
+        send_all(conns[i].fd, request, (size_t) len);
+        receive_line(conns[i].fd, request, sizeof(request));
+        close(conns[i].fd);
+    }
+    free(fds);
+    free(conns);
+    return 0;
+}
@@ -0,0 +1,164 @@
+/** @file
+ * Implementation of the thread pool used by game's engine
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#define _GNU_SOURCE
+
+#include "game_pool.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/** @brief Representation of the thread pool
+ * threads - started threads
+ * threads_num - number of started threads
+ * lock - protects the rest of the structure
+ * work - signals a new job or stopping
+ * done - signals the end of the job
+ * task, arg - current job
+ * tasks - number of job's tasks
+ * next - first task not taken yet
+ * finished - number of finished tasks
+ * job - number of the current job
+ * stop - threads should finish
+*/
+struct game_pool {
+    pthread_t * threads;
+    uint32_t threads_num;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+
+    game_pool_task_t task;
+    void * arg;
+    uint32_t tasks;
+    uint32_t next;
+    uint32_t finished;
+    uint64_t job;
+    bool stop;
+};
+
+/** @brief run_tasks.
+ * Takes tasks of the current job until none is left,
+ * called and returns with the lock held
+ * @param[in,out] pool - the pool
+*/
+static void run_tasks(game_pool_t *pool) {
+    while (pool->next < pool->tasks) {
+        uint32_t t = pool->next++;
+        game_pool_task_t task = pool->task;
+        void * arg = pool->arg;
+
+        pthread_mutex_unlock(&pool->lock);
+        task(arg, t);
+        pthread_mutex_lock(&pool->lock);
+
+        if (++pool->finished == pool->tasks) {
+            pthread_cond_broadcast(&pool->done);
+        }
+    }
+}
+
+/** @brief worker.
+ * Main function of pool's thread
+ * @param[in] data - the pool
+ * @return NULL
+*/
+static void * worker(void *data) {
+    game_pool_t * pool = (game_pool_t *) data;
+
+    // jobs are numbered from 1, a thread started late still takes the first one
+    pthread_mutex_lock(&pool->lock);
+    uint64_t seen = 0;
+    for (;;) {
+        while (!pool->stop && seen == pool->job) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->stop) { break; }
+        seen = pool->job;
+        run_tasks(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+game_pool_t * game_pool_new(uint32_t threads) {
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t) online : 1;
+    }
+
+    game_pool_t * pool = (game_pool_t *) calloc(1, sizeof(game_pool_t));
+    if (pool == NULL) { errno = ENOMEM; return NULL; }
+    pool->threads = (pthread_t *) calloc(threads, sizeof(pthread_t));
+    if (pool->threads == NULL) { free(pool); errno = ENOMEM; return NULL; }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (uint32_t i = 0; i + 1 < threads; i++) {
+        int err = pthread_create(&pool->threads[i], NULL, worker, pool);
+        if (err != 0) {
+            game_pool_delete(pool);
+            errno = err;
+            return NULL;
+        }
+        pool->threads_num++;
+    }
+    return pool;
+}
+
+void game_pool_delete(game_pool_t *pool) {
+    if (pool == NULL) { return; }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint32_t i = 0; i < pool->threads_num; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+uint32_t game_pool_threads(game_pool_t const *pool) {
+    return pool == NULL ? 1 : pool->threads_num + 1;
+}
+
+void game_pool_run(game_pool_t *pool, uint32_t tasks,
+                   game_pool_task_t task, void *arg) {
+    if (pool == NULL || pool->threads_num == 0) {
+        for (uint32_t t = 0; t < tasks; t++) { task(arg, t); }
+        return;
+    }
+    if (tasks == 0) { return; }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->tasks = tasks;
+    pool->next = 0;
+    pool->finished = 0;
+    pool->job++;
+    pthread_cond_broadcast(&pool->work);
+
+    run_tasks(pool);
+    while (pool->finished < pool->tasks) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,70 @@
+/** @file
+ * Interface of the thread pool used by game's engine
+ *
+ * The pool runs numbered tasks of one job on its threads and on the
+ * calling thread. Functions of the engine that accept a pool can also
+ * be given NULL, then every task runs on the calling thread.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#ifndef GAME_POOL_H
+#define GAME_POOL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Declaration of the thread pool's structure.
+ */
+typedef struct game_pool game_pool_t;
+
+/** @brief Task of a job.
+ * @param[in] arg - argument given to @ref game_pool_run
+ * @param[in] task - number of the task, from 0 to tasks - 1
+*/
+typedef void (*game_pool_task_t)(void *arg, uint32_t task);
+
+/** @brief Creates a thread pool.
+ * Starts @p threads - 1 threads, the calling thread of
+ * @ref game_pool_run is the last one. Sets @p errno on failure.
+ * @param[in] threads - number of threads, zero means the number
+ *                      of online processors
+ * @return pointer to the pool or NULL if it could not be created
+*/
+game_pool_t * game_pool_new(uint32_t threads);
+
+/** @brief Stops the threads and frees the pool.
+ * Does nothing if @p pool is NULL.
+ * @param[in] pool - the pool
+*/
+void game_pool_delete(game_pool_t *pool);
+
+/** @brief Gives the number of threads.
+ * @param[in] pool - the pool
+ * @return number of threads including the calling one, 1 for NULL
+*/
+uint32_t game_pool_threads(game_pool_t const *pool);
+
+/** @brief Runs a job.
+ * Calls @p task for every number from 0 to @p tasks - 1 and returns
+ * when all of the calls have finished. Tasks are taken by the threads
+ * in increasing order. The pool runs one job at a time.
+ * @param[in] pool - the pool or NULL
+ * @param[in] tasks - number of tasks
+ * @param[in] task - the task
+ * @param[in] arg - argument of the task
+*/
+void game_pool_run(game_pool_t *pool, uint32_t tasks,
+                   game_pool_task_t task, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GAME_POOL_H */
@@ -0,0 +1,420 @@
+/** @file
+ * Implementation of the alpha-beta searcher
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#include "game_search.h"
+#include <stdatomic.h>
+
+// Longest line of play: every field taken with a pass before each move
+#define MAX_PLY (2 * GAME_SEARCH_MAX_FIELDS + 4)
+// Move of a player without legal moves
+#define PASS 0xFFFFu
+// Bound of scores
+#define INFINITE (1 << 30)
+// Default binary logarithm of the size of the transposition table
+#define TABLE_BITS 20
+// Nodes between checks of the limits
+#define CHECK_NODES 1024
+
+// Kinds of scores in the transposition table
+#define BOUND_EXACT 0
+#define BOUND_LOWER 1
+#define BOUND_UPPER 2
+
+/** @brief Entry of the transposition table, check is the key xor data,
+ * so an entry torn by two threads is not recognized
+*/
+struct entry {
+    atomic_uint_fast64_t check;
+    atomic_uint_fast64_t data;
+};
+typedef struct entry entry_t;
+
+/** @brief State shared by the threads of a search
+ * table - transposition table
+ * mask - number of entries minus one
+ * keys - Zobrist keys of players' fields
+ * side_key - key of player 2 to move
+ * pass_key - key of a position after a pass
+ * games - games of the threads, the first one is searched in place
+ * width, fields - shape of the board
+ * player - player to move at the root
+ * depth - limit of plies
+ * nodes_limit - limit of nodes of the main thread or zero
+ * stop - threads have to finish
+ * nodes - searched positions of finished threads
+ * failed - a thread could not allocate memory
+ * result - result of the main thread
+*/
+struct shared {
+    entry_t * table;
+    size_t mask;
+    uint64_t keys[2][GAME_SEARCH_MAX_FIELDS];
+    uint64_t side_key;
+    uint64_t pass_key;
+    game_t ** games;
+    uint32_t width;
+    uint32_t fields;
+    uint32_t player;
+    uint32_t depth;
+    uint64_t nodes_limit;
+    atomic_bool stop;
+    atomic_uint_fast64_t nodes;
+    atomic_bool failed;
+    game_search_result_t result;
+};
+typedef struct shared shared_t;
+
+/** @brief State of one thread
+ * s - shared state
+ * g - game of the thread
+ * hash - Zobrist hash of the fields
+ * nodes - searched positions
+ * main - the thread gives the result
+ * root_move - best move of the last iteration
+ * killers - two moves that caused cut-offs at every ply
+ * history - counters of cut-offs of players' moves
+ * mask - buffer of @ref game_can_move_mask
+ * moves, order - moves of every ply and their ordering scores
+*/
+struct worker {
+    shared_t * s;
+    game_t * g;
+    uint64_t hash;
+    uint64_t nodes;
+    bool main;
+    uint16_t root_move;
+    uint16_t killers[MAX_PLY][2];
+    int32_t history[2][GAME_SEARCH_MAX_FIELDS];
+    uint8_t mask[GAME_SEARCH_MAX_FIELDS];
+    uint16_t moves[MAX_PLY][GAME_SEARCH_MAX_FIELDS];
+    int32_t order[MAX_PLY][GAME_SEARCH_MAX_FIELDS];
+};
+typedef struct worker worker_t;
+
+/** @brief next_random.
+ * @param[in,out] state - state of xorshift64
+ * @return next random number
+*/
+static inline uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/** @brief position_key.
+ * @param[in] w - the thread
+ * @param[in] side - player to move
+ * @param[in] passed - the previous player passed
+ * @return key of the position in the transposition table
+*/
+static inline uint64_t position_key(worker_t const *w, uint32_t side, bool passed) {
+    return w->hash ^ (side == 2 ? w->s->side_key : 0) ^ (passed ? w->s->pass_key : 0);
+}
+
+/** @brief probe.
+ * @param[in] s - shared state
+ * @param[in] key - key of the position
+ * @param[out] data - data of the entry
+ * @return @p true if the entry of the position was found
+*/
+static inline bool probe(shared_t *s, uint64_t key, uint64_t *data) {
+    entry_t * e = &s->table[key & s->mask];
+    uint64_t check = atomic_load_explicit(&e->check, memory_order_relaxed);
+    *data = atomic_load_explicit(&e->data, memory_order_relaxed);
+    return (check ^ *data) == key;
+}
+
+/** @brief store.
+ * Packs score (32 bits), depth (10), bound (2), horizon (1) and move (16)
+ * @param[in] s - shared state
+ * @param[in] key - key of the position
+ * @param[in] score - the score
+ * @param[in] depth - remaining depth
+ * @param[in] bound - BOUND_EXACT, BOUND_LOWER or BOUND_UPPER
+ * @param[in] horizon - the score depends on the depth limit
+ * @param[in] move - the best move
+*/
+static inline void store(shared_t *s, uint64_t key, int32_t score, uint32_t depth,
+                         uint32_t bound, bool horizon, uint16_t move) {
+    uint64_t data = (uint64_t) (uint32_t) score | (uint64_t) depth << 32 |
+                    (uint64_t) bound << 42 | (uint64_t) horizon << 44 |
+                    (uint64_t) move << 45;
+    entry_t * e = &s->table[key & s->mask];
+    atomic_store_explicit(&e->check, key ^ data, memory_order_relaxed);
+    atomic_store_explicit(&e->data, data, memory_order_relaxed);
+}
+
+/** @brief evaluate.
+ * @param[in] g - the game
+ * @param[in] side - player to move
+ * @param[in] over - the game has ended
+ * @return score from the view of @p side
+*/
+static int32_t evaluate(game_t const *g, uint32_t side, bool over) {
+    int32_t busy = (int32_t) game_busy_fields(g, side) -
+                   (int32_t) game_busy_fields(g, 3 - side);
+    if (over) { return busy * GAME_SEARCH_FIELD; }
+    return busy * GAME_SEARCH_FIELD + (int32_t) game_free_fields(g, side) -
+           (int32_t) game_free_fields(g, 3 - side);
+}
+
+/** @brief generate.
+ * Writes legal moves of @p side with their ordering scores
+ * @param[in,out] w - the thread
+ * @param[in] side - player to move
+ * @param[in] ply - distance from the root
+ * @param[in] first - move of the transposition table or PASS
+ * @return number of moves
+*/
+static uint32_t generate(worker_t *w, uint32_t side, uint32_t ply, uint16_t first) {
+    uint32_t width = w->s->width;
+    uint32_t height = w->s->fields / width;
+    uint32_t stride = (width + 7) / 8;
+    if (!game_can_move_mask(w->g, side, 0, 0, width, height, w->mask)) { return 0; }
+
+    uint16_t * moves = w->moves[ply];
+    int32_t * order = w->order[ply];
+    uint32_t n = 0;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t i = 0; i < stride; i++) {
+            for (uint32_t b = w->mask[y * stride + i]; b; b &= b - 1) {
+                uint16_t f = (uint16_t) (y * width + i * 8 + (uint32_t) __builtin_ctz(b));
+                moves[n] = f;
+                order[n] = f == first ? INFINITE
+                           : f == w->killers[ply][0] ? INFINITE - 1
+                           : f == w->killers[ply][1] ? INFINITE - 2
+                           : w->history[side - 1][f];
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+/** @brief search.
+ * Negamax with alpha-beta pruning
+ * @param[in,out] w - the thread
+ * @param[in] side - player to move
+ * @param[in] depth - remaining plies
+ * @param[in] alpha, beta - window of the score
+ * @param[in] ply - distance from the root
+ * @param[in] passed - the previous player passed
+ * @param[in,out] horizon - set if the score depends on the depth limit
+ * @return score from the view of @p side
+*/
+static int32_t search(worker_t *w, uint32_t side, uint32_t depth, int32_t alpha,
+                      int32_t beta, uint32_t ply, bool passed, bool *horizon) {
+    shared_t * s = w->s;
+    if (++w->nodes % CHECK_NODES == 0 && w->main && s->nodes_limit &&
+        w->nodes >= s->nodes_limit) {
+        atomic_store(&s->stop, true);
+    }
+    if (atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+        *horizon = true;
+        return 0;
+    }
+
+    uint64_t key = position_key(w, side, passed);
+    uint64_t data;
+    uint16_t first = PASS;
+    if (probe(s, key, &data)) {
+        int32_t score = (int32_t) (uint32_t) data;
+        uint32_t bound = (uint32_t) (data >> 42) & 3u;
+        first = (uint16_t) (data >> 45);
+        if (((data >> 32) & 0x3FFu) >= depth &&
+            (bound == BOUND_EXACT || (bound == BOUND_LOWER && score >= beta) ||
+             (bound == BOUND_UPPER && score <= alpha))) {
+            if ((data >> 44) & 1u) { *horizon = true; }
+            if (ply == 0) { w->root_move = first; }
+            return score;
+        }
+    }
+
+    uint32_t n = generate(w, side, ply, first);
+    if (n == 0) {
+        if (ply == 0) { w->root_move = PASS; }
+        if (passed) { return evaluate(w->g, side, true); }
+        if (depth == 0) {
+            *horizon = true;
+            return evaluate(w->g, side, false);
+        }
+        return -search(w, 3 - side, depth - 1, -beta, -alpha, ply + 1, true, horizon);
+    }
+    if (depth == 0) {
+        *horizon = true;
+        return evaluate(w->g, side, false);
+    }
+
+    uint16_t * moves = w->moves[ply];
+    int32_t * order = w->order[ply];
+    int32_t alpha_start = alpha;
+    int32_t best = -INFINITE;
+    uint16_t best_move = moves[0];
+    bool best_horizon = false;
+    for (uint32_t i = 0; i < n; i++) {
+        // the rest of the moves is sorted lazily, cut-offs come early
+        uint32_t top = i;
+        for (uint32_t j = i + 1; j < n; j++) {
+            if (order[j] > order[top]) { top = j; }
+        }
+        uint16_t f = moves[top];
+        moves[top] = moves[i];
+        order[top] = order[i];
+        moves[i] = f;
+
+        game_move(w->g, side, f % s->width, f / s->width);
+        w->hash ^= s->keys[side - 1][f];
+        bool h = false;
+        int32_t score = -search(w, 3 - side, depth - 1, -beta, -alpha, ply + 1, false, &h);
+        game_undo(w->g);
+        w->hash ^= s->keys[side - 1][f];
+
+        if (atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+            *horizon = true;
+            return 0;
+        }
+        best_horizon = best_horizon || h;
+        if (score > best) {
+            best = score;
+            best_move = f;
+        }
+        if (score > alpha) { alpha = score; }
+        if (alpha >= beta) {
+            if (w->killers[ply][0] != f) {
+                w->killers[ply][1] = w->killers[ply][0];
+                w->killers[ply][0] = f;
+            }
+            w->history[side - 1][f] += (int32_t) (depth * depth);
+            break;
+        }
+    }
+
+    uint32_t bound = best <= alpha_start ? BOUND_UPPER
+                     : best >= beta ? BOUND_LOWER : BOUND_EXACT;
+    store(s, key, best, depth, bound, best_horizon, best_move);
+    if (best_horizon) { *horizon = true; }
+    if (ply == 0) { w->root_move = best_move; }
+    return best;
+}
+
+/** @brief search_task.
+ * Task of the pool, deepens the search until the end of the game,
+ * the limit or the stop of the main thread. Helpers start at
+ * different depths with shuffled history, so they fill the table
+ * with other parts of the tree.
+ * @param[in] arg - the shared_t
+ * @param[in] task - number of the thread, 0 for the main one
+*/
+static void search_task(void *arg, uint32_t task) {
+    shared_t * s = (shared_t *) arg;
+    worker_t * w = (worker_t *) calloc(1, sizeof(worker_t));
+    if (w == NULL) {
+        atomic_store(&s->failed, true);
+        if (task == 0) { atomic_store(&s->stop, true); }
+        return;
+    }
+    w->s = s;
+    w->g = s->games[task];
+    w->main = task == 0;
+
+    uint8_t owners[2 * 2 * GAME_SEARCH_MAX_FIELDS];
+    game_feature_planes(w->g, owners, GAME_LAYOUT_NCHW, GAME_PLANES_U8);
+    for (uint32_t f = 0; f < s->fields; f++) {
+        if (owners[f]) { w->hash ^= s->keys[0][f]; }
+        if (owners[s->fields + f]) { w->hash ^= s->keys[1][f]; }
+    }
+    uint64_t rng = 0x9E3779B97F4A7C15u * (task + 1);
+    for (uint32_t f = 0; task && f < s->fields; f++) {
+        w->history[0][f] = (int32_t) (next_random(&rng) % 16);
+        w->history[1][f] = (int32_t) (next_random(&rng) % 16);
+    }
+
+    for (uint32_t depth = 1 + (task & 1); depth <= s->depth; depth++) {
+        bool horizon = false;
+        int32_t score = search(w, s->player, depth, -INFINITE, INFINITE, 0, false, &horizon);
+        if (atomic_load(&s->stop)) { break; }
+        if (w->main) {
+            s->result.score = score;
+            s->result.exact = !horizon;
+            s->result.pass = w->root_move == PASS;
+            s->result.x = w->root_move == PASS ? 0 : w->root_move % s->width;
+            s->result.y = w->root_move == PASS ? 0 : w->root_move / s->width;
+            s->result.depth = depth;
+        }
+        if (!horizon) { break; }
+    }
+    if (w->main) { atomic_store(&s->stop, true); }
+    atomic_fetch_add(&s->nodes, w->nodes);
+    free(w);
+}
+
+bool game_search(game_t *g, uint32_t player, game_search_options_t const *options,
+                 game_pool_t *pool, game_search_result_t *result) {
+    uint32_t width = game_board_width(g);
+    uint64_t fields = (uint64_t) width * game_board_height(g);
+    if (fields == 0 || result == NULL || game_players(g) != 2 || (player != 1 && player != 2) ||
+        fields > GAME_SEARCH_MAX_FIELDS) {
+        errno = EINVAL;
+        return false;
+    }
+    game_search_options_t defaults = { 0, 0, 0 };
+    if (options == NULL) { options = &defaults; }
+    uint32_t bits = options->table_bits ? options->table_bits : TABLE_BITS;
+    if (bits > 30) { errno = EINVAL; return false; }
+
+    shared_t * s = (shared_t *) calloc(1, sizeof(shared_t));
+    uint32_t threads = game_pool_threads(pool);
+    if (s == NULL) { errno = ENOMEM; return false; }
+    s->table = (entry_t *) calloc((size_t) 1 << bits, sizeof(entry_t));
+    s->games = (game_t **) calloc(threads, sizeof(game_t *));
+    bool ok = s->table != NULL && s->games != NULL;
+
+    // helpers search copies made before the main thread changes the game
+    if (ok) { s->games[0] = g; }
+    for (uint32_t t = 1; ok && t < threads; t++) {
+        size_t size;
+        void * data = game_export(g, GAME_FORMAT_PACKED, &size);
+        s->games[t] = data ? game_import(data, size) : NULL;
+        free(data);
+        ok = s->games[t] != NULL;
+    }
+
+    if (ok) {
+        s->mask = ((size_t) 1 << bits) - 1;
+        s->width = width;
+        s->fields = (uint32_t) fields;
+        s->player = player;
+        uint64_t rng = 0x2545F4914F6CDD1Du;
+        for (uint32_t f = 0; f < fields; f++) {
+            s->keys[0][f] = next_random(&rng);
+            s->keys[1][f] = next_random(&rng);
+        }
+        s->side_key = next_random(&rng);
+        s->pass_key = next_random(&rng);
+        uint64_t taken = game_busy_fields(g, 1) + game_busy_fields(g, 2);
+        uint32_t to_end = 2 * (uint32_t) (fields - taken) + 2;
+        s->depth = options->depth && options->depth < to_end ? options->depth : to_end;
+        s->nodes_limit = options->nodes;
+
+        game_pool_run(pool, threads, search_task, s);
+        ok = !atomic_load(&s->failed) && s->result.depth > 0;
+        if (atomic_load(&s->failed)) { errno = ENOMEM; }
+        *result = s->result;
+        result->nodes = atomic_load(&s->nodes);
+    } else {
+        errno = ENOMEM;
+    }
+
+    for (uint32_t t = 1; s->games != NULL && t < threads; t++) { game_delete(s->games[t]); }
+    free(s->games);
+    free(s->table);
+    free(s);
+    return ok;
+}
@@ -0,0 +1,86 @@
+/** @file
+ * Interface of the alpha-beta searcher of two-player games
+ *
+ * Players 1 and 2 move in turns, a player without a legal move passes
+ * and the game ends when both of them pass in a row. The searcher looks
+ * for the move that maximizes the difference between the numbers of
+ * fields of the player to move and of the opponent at the end of the
+ * game. Positions at the depth limit are scored by @ref game_busy_fields
+ * and @ref game_free_fields.
+ *
+ * The search deepens iteratively, makes moves in place and takes them
+ * back with @ref game_undo, orders moves by the transposition table,
+ * killer moves and history counters, and keys the table by a Zobrist
+ * hash updated with every move. With a pool, every thread searches
+ * its own copy of the game sharing the table with the others (lazy SMP).
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#ifndef GAME_SEARCH_H
+#define GAME_SEARCH_H
+
+#include "game.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Score of a difference of one field between the players
+#define GAME_SEARCH_FIELD 1024
+// Largest number of fields of a searched board
+#define GAME_SEARCH_MAX_FIELDS 256
+
+/** @brief Limits of a search
+ * depth - limit of plies, zero for the search to the end of the game
+ * nodes - limit of nodes of the main thread, zero for none
+ * table_bits - binary logarithm of the number of entries
+ *              of the transposition table, zero for 20
+*/
+typedef struct game_search_options {
+    uint32_t depth;
+    uint64_t nodes;
+    uint32_t table_bits;
+} game_search_options_t;
+
+/** @brief Result of a search
+ * score - from the view of the player to move, GAME_SEARCH_FIELD times
+ *         the difference of busy fields plus the difference of free
+ *         fields, only the first part at the end of the game
+ * exact - the score is the result of the best play of both players
+ * pass - the player has no legal move, x and y are not used
+ * x, y - the best move
+ * depth - last completed depth
+ * nodes - number of searched positions of all threads
+*/
+typedef struct game_search_result {
+    int32_t score;
+    bool exact;
+    bool pass;
+    uint32_t x;
+    uint32_t y;
+    uint32_t depth;
+    uint64_t nodes;
+} game_search_result_t;
+
+/** @brief Searches for the best move.
+ * The game is given back in the same state. Sets @p errno to EINVAL
+ * if the game does not have two players or has more than
+ * GAME_SEARCH_MAX_FIELDS fields and to ENOMEM.
+ * @param[in,out] g - the game
+ * @param[in] player - player to move, 1 or 2
+ * @param[in] options - limits or NULL for the search to the end
+ * @param[in] pool - threads of lazy SMP or NULL
+ * @param[out] result - the result
+ * @return @p true if at least the first iteration was completed
+*/
+bool game_search(game_t *g, uint32_t player, game_search_options_t const *options,
+                 game_pool_t *pool, game_search_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GAME_SEARCH_H */
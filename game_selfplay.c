@@ -0,0 +1,643 @@
+/** @file
+ * Self-play data generator
+ *
+ * Plays games on worker threads of a @ref game_pool_t. Players move in
+ * turns, a player without a legal move passes and a game ends when all
+ * of the players pass in a row. Moves are chosen from the legal ones
+ * by a policy. Every finished game is put on a lock-free queue as one
+ * record and a writer thread appends the records to the shard file.
+ * Games finish out of order, so the writer holds records back until
+ * the ones of all earlier games were written.
+ *
+ * The shard starts with "GSP1" and width, height, players and areas.
+ * A game's record is the number of moves and the winner (0 for a tie)
+ * as uint32_t, the final number of fields of every player as uint32_t
+ * and the moves, each one as the player's number in one byte and the
+ * field y * width + x as uint32_t. All of the numbers are little-endian.
+ * The position before a move is the board after the moves before it.
+ *
+ * Usage: game_selfplay [-n games] [-t threads] [-s size] [-k players]
+ * [-a areas] [-P policy] [-S seed] [-o shard] [-c 1]
+ *
+ * With -c 1 the games are played on 1, 2, 4... up to threads threads
+ * and the speed of each run is reported. Games depend only on the seed
+ * and their numbers and are written in the order of the numbers, so the
+ * shard does not depend on the number of threads.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#define _GNU_SOURCE
+
+#include "game.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Players limit of the engine
+#define MAX_PLAYERS 35
+// Number of records the queue can hold, a power of two
+#define QUEUE_SIZE 4096
+// Size of the writer's buffer
+#define BUFFER_SIZE (1 << 20)
+// Number of fields compared by the nearest policy
+#define SAMPLES 4
+
+/** @brief State of a game played by a worker
+ * g - the game
+ * rng - state of the random generator, xorshift64
+ * last - field of player's previous move plus one, zero before it
+*/
+struct play {
+    game_t * g;
+    uint64_t rng;
+    uint32_t last[MAX_PLAYERS + 1];
+};
+typedef struct play play_t;
+
+/** @brief Policy choosing a move.
+ * @param[in,out] play - state of the game
+ * @param[in] player - player to move
+ * @param[in] legal - fields of the legal moves, y * width + x
+ * @param[in] n - number of legal moves, positive
+ * @return index of the chosen move in @p legal
+*/
+typedef uint32_t (*policy_t)(play_t *play, uint32_t player,
+                             uint32_t const *legal, uint32_t n);
+
+/** @brief Finished game waiting for the writer
+ * game - number of the game
+ * size - number of bytes
+ * data - the record
+*/
+struct record {
+    uint64_t game;
+    size_t size;
+    uint8_t data[];
+};
+typedef struct record record_t;
+
+/** @brief Element of the queue
+ * seq - number of the push that may use the slot, or of the push
+ *       that filled it plus one
+ * rec - the record
+*/
+struct slot {
+    atomic_size_t seq;
+    record_t * rec;
+};
+typedef struct slot slot_t;
+
+/** @brief Bounded lock-free queue of records, many producers and one
+ * consumer, after D. Vyukov's bounded MPMC queue
+ * slots - the elements
+ * tail - number of the next push
+ * head - number of the next pop, used only by the consumer
+*/
+struct queue {
+    slot_t slots[QUEUE_SIZE];
+    _Alignas(64) atomic_size_t tail;
+    _Alignas(64) size_t head;
+};
+typedef struct queue queue_t;
+
+/** @brief Options of the run
+ * games - number of games
+ * threads - number of workers, zero means online processors
+ * size - board's width and height
+ * players - number of players
+ * areas - areas limit
+ * policy - name of the policy
+ * seed - seed of the games
+ * shard - output file or NULL
+ * curve - run on 1, 2, 4... threads
+*/
+struct options {
+    uint64_t games;
+    uint32_t threads;
+    uint32_t size;
+    uint32_t players;
+    uint32_t areas;
+    const char * policy;
+    uint64_t seed;
+    const char * shard;
+    bool curve;
+};
+typedef struct options options_t;
+
+/** @brief State of one run
+ * opt - options
+ * policy - the policy
+ * queue - finished games
+ * next - number of the next game to play
+ * moves - number of moves of finished games
+ * bytes - number of written bytes
+ * fd - shard's descriptor or -1
+ * done - workers have finished
+ * failed - a worker or the writer failed
+*/
+struct selfplay {
+    options_t const * opt;
+    policy_t policy;
+    queue_t queue;
+    atomic_uint_fast64_t next;
+    atomic_uint_fast64_t moves;
+    uint64_t bytes;
+    int fd;
+    atomic_bool done;
+    atomic_bool failed;
+};
+typedef struct selfplay selfplay_t;
+
+/** @brief next_random.
+ * @param[in,out] state - state of xorshift64
+ * @return next random number
+*/
+static inline uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/** @brief game_seed.
+ * Mixes the seed with the number of a game, splitmix64
+ * @param[in] seed - seed of the run
+ * @param[in] game - number of the game
+ * @return nonzero state of the game's generator
+*/
+static uint64_t game_seed(uint64_t seed, uint64_t game) {
+    uint64_t z = seed + (game + 1) * 0x9E3779B97F4A7C15u;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+/** @brief policy_random.
+ * Chooses a legal move uniformly
+*/
+static uint32_t policy_random(play_t *play, uint32_t player,
+                              uint32_t const *legal, uint32_t n) {
+    (void) player;
+    (void) legal;
+    return (uint32_t) (next_random(&play->rng) % n);
+}
+
+/** @brief policy_nearest.
+ * Chooses the nearest to player's previous move of a few random
+ * legal moves, so that areas grow instead of being scattered
+*/
+static uint32_t policy_nearest(play_t *play, uint32_t player,
+                               uint32_t const *legal, uint32_t n) {
+    uint32_t best = (uint32_t) (next_random(&play->rng) % n);
+    if (!play->last[player]) { return best; }
+
+    uint32_t width = game_board_width(play->g);
+    uint32_t from = play->last[player] - 1;
+    uint64_t best_distance = UINT64_MAX;
+    for (int i = 0; i < SAMPLES; i++) {
+        uint32_t k = i ? (uint32_t) (next_random(&play->rng) % n) : best;
+        int64_t dx = (int64_t) (legal[k] % width) - (int64_t) (from % width);
+        int64_t dy = (int64_t) (legal[k] / width) - (int64_t) (from / width);
+        uint64_t distance = (uint64_t) (dx * dx + dy * dy);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = k;
+        }
+    }
+    return best;
+}
+
+/** @brief Available policies */
+static const struct {
+    const char * name;
+    policy_t policy;
+} policies[] = {
+    { "random", policy_random },
+    { "nearest", policy_nearest },
+};
+
+/** @brief queue_push.
+ * @param[in,out] q - the queue
+ * @param[in] rec - the record
+ * @return @p false if the queue is full
+*/
+static bool queue_push(queue_t *q, record_t *rec) {
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (;;) {
+        slot_t * s = &q->slots[pos & (QUEUE_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                s->rec = rec;
+                atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/** @brief queue_pop.
+ * Called only by the writer
+ * @param[in,out] q - the queue
+ * @return the oldest record or NULL if the queue is empty
+*/
+static record_t * queue_pop(queue_t *q) {
+    slot_t * s = &q->slots[q->head & (QUEUE_SIZE - 1)];
+    size_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    if (seq != q->head + 1) { return NULL; }
+    record_t * rec = s->rec;
+    atomic_store_explicit(&s->seq, q->head + QUEUE_SIZE, memory_order_release);
+    q->head++;
+    return rec;
+}
+
+/** @brief put_u32.
+ * Writes a little-endian number
+ * @param[out] p - 4 bytes
+ * @param[in] value - the number
+*/
+static inline void put_u32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+}
+
+/** @brief write_all.
+ * @param[in] fd - descriptor
+ * @param[in] data - bytes to write
+ * @param[in] len - number of bytes
+ * @return @p true if all of the bytes were written
+*/
+static bool write_all(int fd, const uint8_t *data, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        data += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+/** @brief Records held back by the writer, a binary min-heap
+ * ordered by numbers of games
+ * recs - the records
+ * count - number of records
+ * cap - capacity of @p recs
+*/
+struct held {
+    record_t ** recs;
+    size_t count;
+    size_t cap;
+};
+typedef struct held held_t;
+
+/** @brief held_push.
+ * @param[in,out] h - the heap
+ * @param[in] rec - the record
+ * @return @p false if memory could not be allocated
+*/
+static bool held_push(held_t *h, record_t *rec) {
+    if (h->count == h->cap) {
+        size_t cap = h->cap ? 2 * h->cap : 64;
+        record_t ** recs = (record_t **) realloc(h->recs, cap * sizeof(record_t *));
+        if (recs == NULL) { return false; }
+        h->recs = recs;
+        h->cap = cap;
+    }
+    size_t i = h->count++;
+    while (i > 0 && h->recs[(i - 1) / 2]->game > rec->game) {
+        h->recs[i] = h->recs[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->recs[i] = rec;
+    return true;
+}
+
+/** @brief held_pop.
+ * @param[in,out] h - the heap
+ * @param[in] game - number of the game
+ * @return record of game @p game or NULL if it is not held
+*/
+static record_t * held_pop(held_t *h, uint64_t game) {
+    if (h->count == 0 || h->recs[0]->game != game) { return NULL; }
+    record_t * top = h->recs[0];
+    record_t * last = h->recs[--h->count];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= h->count) { break; }
+        if (child + 1 < h->count && h->recs[child + 1]->game < h->recs[child]->game) {
+            child++;
+        }
+        if (h->recs[child]->game >= last->game) { break; }
+        h->recs[i] = h->recs[child];
+        i = child;
+    }
+    if (h->count) { h->recs[i] = last; }
+    return top;
+}
+
+/** @brief write_record.
+ * Appends the record to the writer's buffer and frees it
+ * @param[in,out] sp - state of the run
+ * @param[in,out] buf - buffer of BUFFER_SIZE bytes or NULL
+ * @param[in,out] len - number of bytes in the buffer
+ * @param[in] rec - the record
+*/
+static void write_record(selfplay_t *sp, uint8_t *buf, size_t *len, record_t *rec) {
+    if (sp->fd >= 0 && buf != NULL) {
+        if (*len + rec->size > BUFFER_SIZE) {
+            if (!write_all(sp->fd, buf, *len)) { atomic_store(&sp->failed, true); }
+            *len = 0;
+        }
+        if (rec->size > BUFFER_SIZE) {
+            if (!write_all(sp->fd, rec->data, rec->size)) {
+                atomic_store(&sp->failed, true);
+            }
+        } else {
+            memcpy(buf + *len, rec->data, rec->size);
+            *len += rec->size;
+        }
+    }
+    sp->bytes += rec->size;
+    free(rec);
+}
+
+/** @brief writer.
+ * Thread appending records from the queue to the shard
+ * in the order of games' numbers
+ * @param[in] data - the selfplay_t
+ * @return NULL
+*/
+static void * writer(void *data) {
+    selfplay_t * sp = (selfplay_t *) data;
+    uint8_t * buf = (uint8_t *) malloc(BUFFER_SIZE);
+    size_t len = 0;
+    held_t held = { NULL, 0, 0 };
+    uint64_t next = 0;
+    if (buf == NULL) { atomic_store(&sp->failed, true); }
+
+    for (;;) {
+        record_t * rec = queue_pop(&sp->queue);
+        if (rec == NULL) {
+            // records pushed before done was set are still taken
+            if (!atomic_load(&sp->done)) { sched_yield(); continue; }
+            rec = queue_pop(&sp->queue);
+            if (rec == NULL) { break; }
+        }
+        if (!held_push(&held, rec)) {
+            atomic_store(&sp->failed, true);
+            free(rec);
+            continue;
+        }
+        while ((rec = held_pop(&held, next)) != NULL) {
+            write_record(sp, buf, &len, rec);
+            next++;
+        }
+    }
+    // records after a game that failed are never written
+    for (size_t i = 0; i < held.count; i++) { free(held.recs[i]); }
+    free(held.recs);
+    if (sp->fd >= 0 && len && !write_all(sp->fd, buf, len)) {
+        atomic_store(&sp->failed, true);
+    }
+    free(buf);
+    return NULL;
+}
+
+/** @brief play_game.
+ * Plays one game from its initial state and builds its record
+ * @param[in,out] sp - state of the run
+ * @param[in,out] play - state of the game, the game has to be reset
+ * @param[in] mask - buffer of game_can_move_mask for the whole board
+ * @param[in] legal - buffer for width * height fields
+ * @param[in] moves - buffer for width * height moves
+ * @param[in] game - number of the game
+ * @return the record or NULL if it could not be allocated
+*/
+static record_t * play_game(selfplay_t *sp, play_t *play, uint8_t *mask,
+                            uint32_t *legal, uint32_t *moves, uint64_t game) {
+    options_t const * opt = sp->opt;
+    uint32_t size = opt->size;
+    uint32_t stride = (size + 7) / 8;
+    uint32_t taken = 0;
+    memset(play->last, 0, sizeof(play->last));
+
+    // players without moves are skipped and the game ends when nobody has one
+    for (uint32_t player = game_current_player(play->g); player;
+         player = game_current_player(play->g)) {
+        game_can_move_mask(play->g, player, 0, 0, size, size, mask);
+        uint32_t k = 0;
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t i = 0; i < stride; i++) {
+                for (uint8_t b = mask[y * stride + i]; b; b &= (uint8_t) (b - 1)) {
+                    legal[k++] = y * size + i * 8 + (uint32_t) __builtin_ctz(b);
+                }
+            }
+        }
+        uint32_t f = legal[sp->policy(play, player, legal, k)];
+        if (!game_play(play->g, f % size, f / size)) { return NULL; }
+        play->last[player] = f + 1;
+        moves[taken++] = player << 24 | f;
+    }
+
+    size_t bytes = 8 + 4 * (size_t) opt->players + 5 * (size_t) taken;
+    record_t * rec = (record_t *) malloc(sizeof(record_t) + bytes);
+    if (rec == NULL) { return NULL; }
+    rec->size = bytes;
+    rec->game = game;
+
+    uint32_t winner = 0;
+    uint64_t best = 0;
+    uint64_t scores[MAX_PLAYERS];
+    uint8_t * p = rec->data + 8;
+    game_scores(play->g, scores);
+    for (uint32_t q = 1; q <= opt->players; q++, p += 4) {
+        uint64_t fields = scores[q - 1];
+        put_u32(p, (uint32_t) fields);
+        if (fields > best) { best = fields; winner = q; }
+        else if (fields == best) { winner = 0; }
+    }
+    put_u32(rec->data, taken);
+    put_u32(rec->data + 4, winner);
+    for (uint32_t m = 0; m < taken; m++, p += 5) {
+        p[0] = (uint8_t) (moves[m] >> 24);
+        put_u32(p + 1, moves[m] & 0xFFFFFFu);
+    }
+    atomic_fetch_add_explicit(&sp->moves, taken, memory_order_relaxed);
+    return rec;
+}
+
+/** @brief worker.
+ * Task of the pool, plays games until there are none left
+ * @param[in] arg - the selfplay_t
+ * @param[in] task - number of the worker
+*/
+static void worker(void *arg, uint32_t task) {
+    (void) task;
+    selfplay_t * sp = (selfplay_t *) arg;
+    options_t const * opt = sp->opt;
+    size_t fields = (size_t) opt->size * opt->size;
+    play_t play;
+    play.g = game_new(opt->size, opt->size, opt->players, opt->areas);
+    uint8_t * mask = (uint8_t *) malloc((size_t) (opt->size + 7) / 8 * opt->size);
+    uint32_t * legal = (uint32_t *) malloc(fields * sizeof(uint32_t));
+    uint32_t * moves = (uint32_t *) malloc(fields * sizeof(uint32_t));
+    if (play.g == NULL || mask == NULL || legal == NULL || moves == NULL) {
+        atomic_store(&sp->failed, true);
+    }
+
+    while (!atomic_load_explicit(&sp->failed, memory_order_relaxed)) {
+        uint64_t game = atomic_fetch_add(&sp->next, 1);
+        if (game >= opt->games) { break; }
+        play.rng = game_seed(opt->seed, game);
+        game_reset(play.g);
+
+        record_t * rec = play_game(sp, &play, mask, legal, moves, game);
+        if (rec == NULL) {
+            atomic_store(&sp->failed, true);
+            break;
+        }
+        while (!queue_push(&sp->queue, rec)) { sched_yield(); }
+    }
+    game_delete(play.g);
+    free(mask);
+    free(legal);
+    free(moves);
+}
+
+/** @brief now.
+ * @return seconds of the monotonic clock
+*/
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec + (double) t.tv_nsec * 1e-9;
+}
+
+/** @brief run.
+ * Plays all of the games on @p threads threads
+ * @param[in] opt - options
+ * @param[in] policy - the policy
+ * @param[in] threads - number of workers
+ * @param[in] fd - shard's descriptor or -1
+ * @return number of seconds or a negative number on error
+*/
+static double run(options_t const *opt, policy_t policy, uint32_t threads, int fd) {
+    selfplay_t * sp = (selfplay_t *) calloc(1, sizeof(selfplay_t));
+    game_pool_t * pool = game_pool_new(threads);
+    if (sp == NULL || pool == NULL) { free(sp); game_pool_delete(pool); return -1; }
+    sp->opt = opt;
+    sp->policy = policy;
+    sp->fd = fd;
+    for (size_t i = 0; i < QUEUE_SIZE; i++) { atomic_init(&sp->queue.slots[i].seq, i); }
+
+    double start = now();
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, writer, sp) != 0) {
+        free(sp);
+        game_pool_delete(pool);
+        return -1;
+    }
+    game_pool_run(pool, game_pool_threads(pool), worker, sp);
+    atomic_store(&sp->done, true);
+    pthread_join(thread, NULL);
+    double seconds = now() - start;
+
+    uint64_t moves = atomic_load(&sp->moves);
+    bool failed = atomic_load(&sp->failed);
+    printf("threads %3u  %10.1f games/s  %12.1f moves/s  %.2f moves/game  "
+           "%llu bytes\n", game_pool_threads(pool), (double) opt->games / seconds,
+           (double) moves / seconds, (double) moves / (double) opt->games,
+           (unsigned long long) sp->bytes);
+    game_pool_delete(pool);
+    free(sp);
+    return failed ? -1 : seconds;
+}
+
+/** @brief Runs the generator.
+ * @return Zero on success and 1 on error
+ */
+int main(int argc, char *argv[]) {
+    options_t opt = { 10000, 0, 9, 2, 9, "random", 1, NULL, false };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char * value = argv[i + 1];
+        if (!strcmp(argv[i], "-n")) { opt.games = strtoull(value, NULL, 10); }
+        else if (!strcmp(argv[i], "-t")) { opt.threads = (uint32_t) atoi(value); }
+        else if (!strcmp(argv[i], "-s")) { opt.size = (uint32_t) atoi(value); }
+        else if (!strcmp(argv[i], "-k")) { opt.players = (uint32_t) atoi(value); }
+        else if (!strcmp(argv[i], "-a")) { opt.areas = (uint32_t) atoi(value); }
+        else if (!strcmp(argv[i], "-P")) { opt.policy = value; }
+        else if (!strcmp(argv[i], "-S")) { opt.seed = strtoull(value, NULL, 10); }
+        else if (!strcmp(argv[i], "-o")) { opt.shard = value; }
+        else if (!strcmp(argv[i], "-c")) { opt.curve = atoi(value) != 0; }
+    }
+    policy_t policy = NULL;
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (!strcmp(opt.policy, policies[i].name)) { policy = policies[i].policy; }
+    }
+    // fields have to fit in 24 bits of a move
+    if (!opt.games || !opt.size || opt.size > 4096 || !opt.players ||
+        opt.players > MAX_PLAYERS || !opt.areas || policy == NULL) {
+        fprintf(stderr, "game_selfplay: wrong options\n");
+        return 1;
+    }
+    if (opt.threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        opt.threads = online > 0 ? (uint32_t) online : 1;
+    }
+
+    int fd = -1;
+    if (opt.shard != NULL) {
+        fd = open(opt.shard, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        uint8_t header[20] = { 'G', 'S', 'P', '1' };
+        put_u32(header + 4, opt.size);
+        put_u32(header + 8, opt.size);
+        put_u32(header + 12, opt.players);
+        put_u32(header + 16, opt.areas);
+        if (fd < 0 || !write_all(fd, header, sizeof(header))) {
+            fprintf(stderr, "game_selfplay: %s: %s\n", opt.shard, strerror(errno));
+            if (fd >= 0) { close(fd); }
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    if (opt.curve) {
+        double single = 0;
+        for (uint32_t t = 1; ok && t <= opt.threads; t = t < opt.threads && 2 * t > opt.threads
+                                                         ? opt.threads : 2 * t) {
+            // only the first run goes to the shard
+            double seconds = run(&opt, policy, t, t == 1 ? fd : -1);
+            ok = seconds >= 0;
+            if (t == 1) { single = seconds; }
+            if (ok) { printf("             speedup %.2f\n", single / seconds); }
+        }
+    } else {
+        ok = run(&opt, policy, opt.threads, fd) >= 0;
+    }
+    if (fd >= 0 && close(fd) != 0) { ok = false; }
+    if (!ok) { fprintf(stderr, "game_selfplay: failed\n"); }
+    return ok ? 0 : 1;
+}
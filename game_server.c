@@ -0,0 +1,536 @@
+/** @file
+ * Game server speaking a line protocol
+ *
+ * Hosts games of the engine over TCP or Unix sockets.
+ * Every request is one line, the reply is one line
+ * (BOARD reply is followed by the board's description):
+ *
+ *     NEW width height players areas  ->  id
+ *     MOVE id player x y              ->  1 | 0 reason
+ *     BUSY id player                  ->  number of busy fields
+ *     FREE id player                  ->  number of free fields
+ *     BOARD id                        ->  length, then the board
+ *     DEL id                          ->  1 | 0
+ *
+ * Commands may be shortened to their first letter, except BOARD
+ * which is P. Wrong requests get reply "ERR". Requests can be
+ * pipelined, replies are sent in the same order.
+ *
+ * NEW is refused with "ERR" when the board has more fields than allowed
+ * for one game or the games of the connection would have more fields
+ * than allowed for one connection. Only the connection that created
+ * a game can delete it, the other ones get reply "0". Games of
+ * a connection are deleted when it is closed.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#define _GNU_SOURCE
+
+#include "game.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Default TCP port
+#define DEFAULT_PORT 5555
+// Size of one read from a socket
+#define READ_CHUNK 65536
+// Events handled in one epoll_wait call
+#define MAX_EVENTS 64
+// Longest accepted request line
+#define MAX_LINE 256
+// Bytes read from one connection in one wakeup
+#define READ_BUDGET (MAX_LINE + READ_CHUNK)
+// Default limit of fields of one game
+#define DEFAULT_GAME_FIELDS (UINT64_C(1) << 22)
+// Default limit of fields of all games of one connection
+#define DEFAULT_CONN_FIELDS (UINT64_C(1) << 24)
+
+/** @brief Representation of client's connection
+ * fd - socket
+ * in - received bytes that were not parsed yet
+ * out - replies that were not sent yet
+ * in_len, out_len - number of bytes in the buffers
+ * in_cap, out_cap - capacities of the buffers
+ * out_sent - number of bytes of @p out already sent
+ * writing - whether the socket waits for EPOLLOUT
+ * closing - the client finished sending, the connection is closed
+ *           when all of the replies are sent
+ * fields - number of fields of games created by the connection
+*/
+struct conn {
+    int fd;
+    bool writing;
+    bool closing;
+    char * in;
+    size_t in_len;
+    size_t in_cap;
+    char * out;
+    size_t out_len;
+    size_t out_cap;
+    size_t out_sent;
+    uint64_t fields;
+};
+typedef struct conn conn_t;
+
+/** @brief Representation of hosted games
+ * games - array of games indexed by id, NULL for unused ids
+ * owners - connections that created the games, indexed by id
+ * cap - size of the arrays
+ * game_fields - limit of fields of one game
+ * conn_fields - limit of fields of all games of one connection
+*/
+struct server {
+    game_t ** games;
+    conn_t ** owners;
+    uint32_t cap;
+    uint64_t game_fields;
+    uint64_t conn_fields;
+};
+typedef struct server server_t;
+
+/** @brief reserve.
+ * Makes sure the buffer can hold @p need bytes
+ * @param[in,out] buf - buffer
+ * @param[in,out] cap - buffer's capacity
+ * @param[in] need - required capacity
+ * @return @p true on success and @p false if memory could not be allocated
+*/
+static bool reserve(char ** buf, size_t * cap, size_t need) {
+    if (need <= *cap) { return true; }
+    size_t new_cap = *cap ? *cap : READ_CHUNK;
+    while (new_cap < need) { new_cap *= 2; }
+    char * tmp = (char *) realloc(*buf, new_cap);
+    if (tmp == NULL) { return false; }
+    *buf = tmp;
+    *cap = new_cap;
+    return true;
+}
+
+/** @brief reply.
+ * Appends bytes to connection's output
+ * @param[in,out] c - connection
+ * @param[in] data - bytes to append
+ * @param[in] len - number of bytes
+ * @return @p true on success and @p false if memory could not be allocated
+*/
+static bool reply(conn_t * c, const char * data, size_t len) {
+    if (!reserve(&c->out, &c->out_cap, c->out_len + len)) { return false; }
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+    return true;
+}
+
+/** @brief reply_number.
+ * Appends a number and a new line to connection's output
+ * @param[in,out] c - connection
+ * @param[in] value - number to write
+ * @return @p true on success and @p false if memory could not be allocated
+*/
+static bool reply_number(conn_t * c, uint64_t value) {
+    char tmp[24];
+    size_t len = sizeof(tmp);
+    tmp[--len] = '\n';
+    do {
+        tmp[--len] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value);
+    return reply(c, tmp + len, sizeof(tmp) - len);
+}
+
+/** @brief parse_args.
+ * Reads unsigned 32-bit numbers separated by spaces
+ * @param[in] p - beginning of the arguments
+ * @param[in] end - end of the line
+ * @param[out] args - read numbers
+ * @param[in] count - expected number of arguments
+ * @return @p true if exactly @p count numbers were read
+*/
+static bool parse_args(const char * p, const char * end,
+                       uint32_t * args, int count) {
+    for (int i = 0; i < count; i++) {
+        if (p == end || *p != ' ') { return false; }
+        while (p < end && *p == ' ') { p++; }
+        if (p == end || *p < '0' || *p > '9') { return false; }
+        uint64_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (uint64_t) (*p - '0');
+            if (value > UINT32_MAX) { return false; }
+            p++;
+        }
+        args[i] = (uint32_t) value;
+    }
+    while (p < end && (*p == ' ' || *p == '\r')) { p++; }
+    return p == end;
+}
+
+/** @brief find_game.
+ * @param[in] s - server
+ * @param[in] id - game's id
+ * @return game with given id or NULL
+*/
+static game_t * find_game(server_t * s, uint32_t id) {
+    return id < s->cap ? s->games[id] : NULL;
+}
+
+/** @brief game_fields.
+ * @param[in] g - game
+ * @return number of fields of the board
+*/
+static uint64_t game_fields(game_t const * g) {
+    return (uint64_t) game_board_width(g) * game_board_height(g);
+}
+
+/** @brief add_game.
+ * Stores new game under the first unused id
+ * @param[in,out] s - server
+ * @param[in] g - new game
+ * @param[in,out] owner - connection that created the game
+ * @return id of the game or UINT32_MAX if memory could not be allocated
+*/
+static uint32_t add_game(server_t * s, game_t * g, conn_t * owner) {
+    uint32_t id = 0;
+    while (id < s->cap && s->games[id] != NULL) { id++; }
+    if (id == s->cap) {
+        uint32_t cap = s->cap ? s->cap * 2 : 64;
+        game_t ** games = (game_t **) realloc(s->games, cap * sizeof(game_t *));
+        if (games == NULL) { return UINT32_MAX; }
+        memset(games + s->cap, 0, (cap - s->cap) * sizeof(game_t *));
+        s->games = games;
+        conn_t ** owners = (conn_t **) realloc(s->owners, cap * sizeof(conn_t *));
+        if (owners == NULL) { return UINT32_MAX; }
+        s->owners = owners;
+        s->cap = cap;
+    }
+    s->games[id] = g;
+    s->owners[id] = owner;
+    owner->fields += game_fields(g);
+    return id;
+}
+
+/** @brief remove_game.
+ * Deletes the game and frees its id
+ * @param[in,out] s - server
+ * @param[in] id - id of an existing game
+*/
+static void remove_game(server_t * s, uint32_t id) {
+    s->owners[id]->fields -= game_fields(s->games[id]);
+    game_delete(s->games[id]);
+    s->games[id] = NULL;
+    s->owners[id] = NULL;
+}
+
+/** @brief reply_board.
+ * Appends length of the board's description and the description
+ * @param[in] s - server
+ * @param[in,out] c - connection that sent the request
+ * @param[in] p - arguments of the request
+ * @param[in] end - end of the request
+ * @return @p false if memory could not be allocated
+*/
+static bool reply_board(server_t * s, conn_t * c, const char * p, const char * end) {
+    uint32_t id;
+    game_t * g;
+    if (!parse_args(p, end, &id, 1) || (g = find_game(s, id)) == NULL) {
+        return reply(c, "ERR\n", 4);
+    }
+    char * board = game_board(g);
+    if (board == NULL) { return false; }
+    size_t board_len = strlen(board);
+    bool ok = reply_number(c, board_len) && reply(c, board, board_len);
+    free(board);
+    return ok;
+}
+
+/** @brief execute.
+ * Executes one request and appends its reply
+ * @param[in,out] s - server
+ * @param[in,out] c - connection that sent the request
+ * @param[in] line - request without the new line
+ * @param[in] end - end of the request
+ * @return @p false if memory could not be allocated
+*/
+static bool execute(server_t * s, conn_t * c, const char * line, const char * end) {
+    static const char err[] = "ERR\n";
+    const char * p = line;
+    while (p < end && *p >= 'A' && *p <= 'Z') { p++; }
+    size_t len = (size_t) (p - line);
+    uint32_t args[4];
+    game_t * g;
+
+    if (len == 0) {
+        return reply(c, err, sizeof(err) - 1);
+    }
+    switch (line[0]) {
+        case 'M':
+            if ((len == 1 || (len == 4 && !memcmp(line, "MOVE", 4)))
+                && parse_args(p, end, args, 4)
+                && (g = find_game(s, args[0])) != NULL) {
+                game_move_result_t result =
+                    game_move_ex(g, args[1], args[2], args[3], NULL);
+                if (result == GAME_MOVE_OK) { return reply(c, "1\n", 2); }
+                char tmp[4] = {'0', ' ', (char) ('0' + result), '\n'};
+                return reply(c, tmp, sizeof(tmp));
+            }
+            break;
+        case 'N':
+            if ((len == 1 || (len == 3 && !memcmp(line, "NEW", 3)))
+                && parse_args(p, end, args, 4)) {
+                uint64_t fields = (uint64_t) args[0] * args[1];
+                if (fields > s->game_fields
+                    || fields > s->conn_fields - c->fields) { break; }
+                g = game_new(args[0], args[1], args[2], args[3]);
+                if (g == NULL) { break; }
+                uint32_t id = add_game(s, g, c);
+                if (id == UINT32_MAX) { game_delete(g); return false; }
+                return reply_number(c, id);
+            }
+            break;
+        case 'B':
+            if ((len == 1 || (len == 4 && !memcmp(line, "BUSY", 4)))
+                && parse_args(p, end, args, 2)
+                && (g = find_game(s, args[0])) != NULL) {
+                return reply_number(c, game_busy_fields(g, args[1]));
+            }
+            if (len == 5 && !memcmp(line, "BOARD", 5)) {
+                return reply_board(s, c, p, end);
+            }
+            break;
+        case 'F':
+            if ((len == 1 || (len == 4 && !memcmp(line, "FREE", 4)))
+                && parse_args(p, end, args, 2)
+                && (g = find_game(s, args[0])) != NULL) {
+                return reply_number(c, game_free_fields(g, args[1]));
+            }
+            break;
+        case 'P':
+            if (len == 1) { return reply_board(s, c, p, end); }
+            break;
+        case 'D':
+            if ((len == 1 || (len == 3 && !memcmp(line, "DEL", 3)))
+                && parse_args(p, end, args, 1)) {
+                g = find_game(s, args[0]);
+                if (g == NULL || s->owners[args[0]] != c) {
+                    return reply(c, "0\n", 2);
+                }
+                remove_game(s, args[0]);
+                return reply(c, "1\n", 2);
+            }
+            break;
+    }
+    return reply(c, err, sizeof(err) - 1);
+}
+
+/** @brief set_nonblocking.
+ * @param[in] fd - descriptor
+ * @return @p true on success
+*/
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/** @brief flush_output.
+ * Sends as much of pending replies as the socket accepts
+ * @param[in,out] c - connection
+ * @return @p false if the connection failed
+*/
+static bool flush_output(conn_t * c) {
+    while (c->out_sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_sent,
+                         c->out_len - c->out_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { return true; }
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        c->out_sent += (size_t) n;
+    }
+    c->out_len = c->out_sent = 0;
+    return true;
+}
+
+/** @brief handle_input.
+ * Reads available requests, at most READ_BUDGET bytes, and executes
+ * all complete lines. The rest is read on the next EPOLLIN.
+ * @param[in,out] s - server
+ * @param[in,out] c - connection
+ * @return @p false if the connection should be closed
+*/
+static bool handle_input(server_t * s, conn_t * c) {
+    size_t budget = READ_BUDGET;
+    while (budget > 0) {
+        if (!reserve(&c->in, &c->in_cap, c->in_len + READ_CHUNK)) { return false; }
+        size_t room = c->in_cap - c->in_len;
+        if (room > budget) { room = budget; }
+        ssize_t n = recv(c->fd, c->in + c->in_len, room, 0);
+        if (n == 0) { c->closing = true; break; }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        c->in_len += (size_t) n;
+        budget -= (size_t) n;
+        if ((size_t) n < room) { break; }
+    }
+
+    // the whole batch of pipelined requests is answered at once
+    char * line = c->in;
+    char * end = c->in + c->in_len;
+    char * nl;
+    while ((nl = memchr(line, '\n', (size_t) (end - line))) != NULL) {
+        if (!execute(s, c, line, nl)) { return false; }
+        line = nl + 1;
+    }
+    if (end - line > MAX_LINE) { return false; }
+    c->in_len = (size_t) (end - line);
+    memmove(c->in, line, c->in_len);
+
+    return flush_output(c);
+}
+
+/** @brief close_conn.
+ * Deletes games created by the connection
+ * @param[in,out] s - server
+ * @param[in] c - connection to close and free
+*/
+static void close_conn(server_t * s, conn_t * c) {
+    for (uint32_t id = 0; id < s->cap && c->fields > 0; id++) {
+        if (s->games[id] != NULL && s->owners[id] == c) { remove_game(s, id); }
+    }
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+/** @brief open_listener.
+ * Creates listening socket
+ * @param[in] path - path of Unix socket or NULL for TCP
+ * @param[in] port - TCP port
+ * @return socket or -1 on error
+*/
+static int open_listener(const char * path, uint16_t port) {
+    int fd;
+    if (path != NULL) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr.sun_path)) { return -1; }
+        strcpy(addr.sun_path, path);
+        unlink(path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) { return -1; }
+        if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) { return -1; }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) < 0 || !set_nonblocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** @brief Runs the server.
+ * Usage: game_server [-p port | -u path] [-f fields per game]
+ * [-F fields per connection]
+ * @return Zero on success and 1 on error
+ */
+int main(int argc, char *argv[]) {
+    const char * path = NULL;
+    uint16_t port = DEFAULT_PORT;
+    server_t s = { NULL, NULL, 0, DEFAULT_GAME_FIELDS, DEFAULT_CONN_FIELDS };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-u")) { path = argv[i + 1]; }
+        else if (!strcmp(argv[i], "-p")) { port = (uint16_t) atoi(argv[i + 1]); }
+        else if (!strcmp(argv[i], "-f")) { s.game_fields = strtoull(argv[i + 1], NULL, 10); }
+        else if (!strcmp(argv[i], "-F")) { s.conn_fields = strtoull(argv[i + 1], NULL, 10); }
+    }
+
+    int listener = open_listener(path, port);
+    if (listener < 0) {
+        perror("game_server");
+        return 1;
+    }
+    int ep = epoll_create1(0);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (ep < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, listener, &ev) < 0) {
+        perror("game_server");
+        return 1;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    for (;;) {
+        int n = epoll_wait(ep, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            perror("game_server");
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            conn_t * c = (conn_t *) events[i].data.ptr;
+            if (c == NULL) {
+                // new clients
+                int fd;
+                while ((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+                    int one = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    c = (conn_t *) calloc(1, sizeof(conn_t));
+                    if (c == NULL) { close(fd); continue; }
+                    c->fd = fd;
+                    struct epoll_event cev = { .events = EPOLLIN | EPOLLRDHUP,
+                                               .data.ptr = c };
+                    if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &cev) < 0) { close_conn(&s, c); }
+                }
+                continue;
+            }
+
+            bool ok = !(events[i].events & EPOLLERR);
+            if (ok && (events[i].events & EPOLLOUT)) { ok = flush_output(c); }
+            if (ok && !c->writing && !c->closing
+                && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                ok = handle_input(&s, c);
+            }
+            // replies to the last requests are sent before closing
+            if (ok && c->closing && c->out_len == 0) { ok = false; }
+            if (!ok) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+                close_conn(&s, c);
+                continue;
+            }
+            // wait for the socket to drain before reading more requests
+            if (c->writing != (c->out_len > 0)) {
+                c->writing = c->out_len > 0;
+                struct epoll_event cev = { .data.ptr = c };
+                cev.events = c->writing ? EPOLLOUT : EPOLLIN | EPOLLRDHUP;
+                epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &cev);
+            }
+        }
+    }
+}
@@ -0,0 +1,359 @@
+/** @file
+ * Interactive terminal client of the game
+ *
+ * Arrows move the cursor, space or enter sets current player's pawn,
+ * 'c' skips the turn and Ctrl-D ends the game. The screen shows
+ * a part of the board that follows the cursor. After a move only
+ * the changed field and the status line are redrawn.
+ *
+ * @author Tsimafei Lukashevich
+ * @copyright University of Warsaw
+ * @date 2023
+*/
+
+#define _GNU_SOURCE
+
+#include "game.h"
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Size of the output buffer
+#define OUT_SIZE 65536
+// Ctrl-D key
+#define KEY_EOF 4
+
+/** @brief Representation of the client
+ * g - the game
+ * owner - copy of fields' owners, column-major, changed only by moves
+ * player - player on turn, zero at the end of the game
+ * cx, cy - cursor's position on the board
+ * vx, vy - bottom left field of the visible part of the board
+ * vw, vh - size of the visible part of the board
+ * out - buffered escape sequences
+ * out_len - number of buffered bytes
+*/
+struct term {
+    game_t * g;
+    uint8_t * owner;
+    uint32_t width;
+    uint32_t height;
+    uint32_t player;
+    uint32_t cx, cy;
+    uint32_t vx, vy;
+    uint32_t vw, vh;
+    char out[OUT_SIZE];
+    size_t out_len;
+};
+typedef struct term term_t;
+
+// Colors of players, ANSI foreground codes
+static const int colors[] = { 31, 32, 33, 34, 35, 36, 91, 92, 93, 94, 95, 96 };
+
+// Terminal settings restored at exit
+static struct termios saved;
+
+// Whether the terminal is in raw mode
+static bool raw_mode = false;
+
+// Set by SIGWINCH
+static volatile sig_atomic_t resized = 1;
+
+/** @brief on_resize.
+ * SIGWINCH handler
+ * @param[in] sig - signal's number
+*/
+static void on_resize(int sig) {
+    (void) sig;
+    resized = 1;
+}
+
+/** @brief flush.
+ * Writes buffered output to the terminal
+ * @param[in,out] t - client
+*/
+static void flush(term_t * t) {
+    size_t done = 0;
+    while (done < t->out_len) {
+        ssize_t n = write(STDOUT_FILENO, t->out + done, t->out_len - done);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { break; }
+        done += (size_t) n;
+    }
+    t->out_len = 0;
+}
+
+/** @brief put.
+ * Buffers bytes for the terminal
+ * @param[in,out] t - client
+ * @param[in] data - bytes
+ * @param[in] len - number of bytes
+*/
+static void put(term_t * t, const char * data, size_t len) {
+    if (t->out_len + len > OUT_SIZE) { flush(t); }
+    memcpy(t->out + t->out_len, data, len);
+    t->out_len += len;
+}
+
+/** @brief putf.
+ * Buffers formatted text for the terminal
+ * @param[in,out] t - client
+ * @param[in] fmt - format as in printf
+*/
+__attribute__((format(printf, 2, 3)))
+static void putf(term_t * t, const char * fmt, ...) {
+    char tmp[256];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+    if (len > 0) {
+        put(t, tmp, (size_t) len < sizeof(tmp) ? (size_t) len : sizeof(tmp) - 1);
+    }
+}
+
+/** @brief color_of.
+ * @param[in] player - player's number or zero
+ * @return ANSI color of the player, 39 for free fields
+*/
+static int color_of(uint32_t player) {
+    return player ? colors[(player - 1) % (sizeof(colors) / sizeof(colors[0]))] : 39;
+}
+
+/** @brief move_to.
+ * Moves terminal's cursor to the field
+ * @param[in,out] t - client
+ * @param[in] x - column's number of visible field
+ * @param[in] y - row's number of visible field
+*/
+static void move_to(term_t * t, uint32_t x, uint32_t y) {
+    putf(t, "\x1b[%u;%uH", t->vy + t->vh - y, x - t->vx + 1);
+}
+
+/** @brief draw_field.
+ * Redraws one visible field
+ * @param[in,out] t - client
+ * @param[in] x - column's number
+ * @param[in] y - row's number
+*/
+static void draw_field(term_t * t, uint32_t x, uint32_t y) {
+    uint32_t player = t->owner[(uint64_t) x * t->height + y];
+    move_to(t, x, y);
+    putf(t, "\x1b[%dm%c\x1b[39m", color_of(player), game_player(t->g, player));
+}
+
+/** @brief draw_status.
+ * Redraws the status line below the board
+ * @param[in,out] t - client
+*/
+static void draw_status(term_t * t) {
+    putf(t, "\x1b[%u;1H\x1b[2K", t->vh + 1);
+    putf(t, "\x1b[%dmplayer %c\x1b[39m  busy %llu  free %llu  (%u, %u)",
+         color_of(t->player), game_player(t->g, t->player),
+         (unsigned long long) game_busy_fields(t->g, t->player),
+         (unsigned long long) game_free_fields(t->g, t->player), t->cx, t->cy);
+}
+
+/** @brief draw_all.
+ * Redraws visible part of the board, used after scrolling and resizing
+ * @param[in,out] t - client
+*/
+static void draw_all(term_t * t) {
+    put(t, "\x1b[2J", 4);
+    for (uint32_t row = 0; row < t->vh; row++) {
+        uint32_t y = t->vy + t->vh - 1 - row;
+        int color = -1;
+        putf(t, "\x1b[%u;1H", row + 1);
+        for (uint32_t x = t->vx; x < t->vx + t->vw; x++) {
+            uint32_t player = t->owner[(uint64_t) x * t->height + y];
+            if (color_of(player) != color) {
+                color = color_of(player);
+                putf(t, "\x1b[%dm", color);
+            }
+            char c = game_player(t->g, player);
+            put(t, &c, 1);
+        }
+        put(t, "\x1b[39m", 5);
+    }
+}
+
+/** @brief fit_view.
+ * Resizes and scrolls the visible part so that it contains the cursor
+ * @param[in,out] t - client
+ * @return @p true if the visible part changed
+*/
+static bool fit_view(term_t * t) {
+    uint32_t vx = t->vx, vy = t->vy, vw = t->vw, vh = t->vh;
+    if (resized) {
+        struct winsize ws;
+        resized = 0;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) < 0 || !ws.ws_col || ws.ws_row < 2) {
+            ws.ws_col = 80;
+            ws.ws_row = 24;
+        }
+        t->vw = ws.ws_col < t->width ? ws.ws_col : t->width;
+        t->vh = ws.ws_row - 1u < t->height ? ws.ws_row - 1u : t->height;
+        vw = 0;
+    }
+    // jump by half of the screen, so that scrolling redraws rarely
+    if (t->cx < t->vx || t->cx >= t->vx + t->vw) {
+        t->vx = t->cx > t->vw / 2 ? t->cx - t->vw / 2 : 0;
+    }
+    if (t->cy < t->vy || t->cy >= t->vy + t->vh) {
+        t->vy = t->cy > t->vh / 2 ? t->cy - t->vh / 2 : 0;
+    }
+    if (t->vx + t->vw > t->width) { t->vx = t->width - t->vw; }
+    if (t->vy + t->vh > t->height) { t->vy = t->height - t->vh; }
+    return vx != t->vx || vy != t->vy || vw != t->vw || vh != t->vh;
+}
+
+/** @brief read_key.
+ * Reads one key, arrows are translated to 'A'..'D' with high bit set
+ * @return the key or -1 at the end of input
+*/
+static int read_key(void) {
+    unsigned char c;
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, &c, 1);
+        if (n == 1) { break; }
+        if (n < 0 && errno == EINTR) { return resized ? 0 : -1; }
+        return -1;
+    }
+    if (c != '\x1b') { return c; }
+
+    unsigned char seq[2];
+    if (read(STDIN_FILENO, &seq[0], 1) != 1 || seq[0] != '[') { return c; }
+    if (read(STDIN_FILENO, &seq[1], 1) != 1) { return c; }
+    return seq[1] >= 'A' && seq[1] <= 'D' ? 0x100 | seq[1] : c;
+}
+
+/** @brief input_pending.
+ * @return @p true if next key can be read without waiting
+*/
+static bool input_pending(void) {
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+    return poll(&pfd, 1, 0) > 0;
+}
+
+/** @brief restore_terminal.
+ * Leaves raw mode and the alternate screen
+*/
+static void restore_terminal(void) {
+    if (!raw_mode) { return; }
+    raw_mode = false;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved);
+    const char reset[] = "\x1b[0m\x1b[?1049l";
+    if (write(STDOUT_FILENO, reset, sizeof(reset) - 1) < 0) { return; }
+}
+
+/** @brief Runs interactive game.
+ * Usage: game_term width height players areas
+ * @return Zero on success and 1 on error
+ */
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        fprintf(stderr, "usage: %s width height players areas\n", argv[0]);
+        return 1;
+    }
+    static term_t t;
+    t.g = game_new((uint32_t) strtoul(argv[1], NULL, 10),
+                   (uint32_t) strtoul(argv[2], NULL, 10),
+                   (uint32_t) strtoul(argv[3], NULL, 10),
+                   (uint32_t) strtoul(argv[4], NULL, 10));
+    if (t.g == NULL) {
+        fprintf(stderr, "%s: wrong parameters\n", argv[0]);
+        return 1;
+    }
+    t.width = game_board_width(t.g);
+    t.height = game_board_height(t.g);
+    t.owner = (uint8_t *) calloc((uint64_t) t.width * t.height, 1);
+    if (t.owner == NULL || tcgetattr(STDIN_FILENO, &saved) < 0) {
+        fprintf(stderr, "%s: cannot start\n", argv[0]);
+        return 1;
+    }
+
+    struct termios raw = saved;
+    raw.c_lflag &= ~(tcflag_t) (ICANON | ECHO | ISIG);
+    raw.c_iflag &= ~(tcflag_t) (IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+    raw_mode = true;
+    atexit(restore_terminal);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_resize;
+    sigaction(SIGWINCH, &sa, NULL);
+
+    put(&t, "\x1b[?1049h", 8);
+    t.player = game_current_player(t.g);
+    bool playing = true;
+    bool redraw = true;
+    while (playing) {
+        // keys that are already typed are handled before redrawing
+        if (!input_pending()) {
+            if (fit_view(&t) || redraw) { draw_all(&t); }
+            redraw = false;
+            draw_status(&t);
+            move_to(&t, t.cx, t.cy);
+            flush(&t);
+        }
+
+        int key = read_key();
+        switch (key) {
+            case -1:
+            case KEY_EOF:
+                playing = false;
+                break;
+            case 0x100 | 'A':
+                if (t.cy + 1 < t.height) { t.cy++; }
+                break;
+            case 0x100 | 'B':
+                if (t.cy > 0) { t.cy--; }
+                break;
+            case 0x100 | 'C':
+                if (t.cx + 1 < t.width) { t.cx++; }
+                break;
+            case 0x100 | 'D':
+                if (t.cx > 0) { t.cx--; }
+                break;
+            case ' ':
+            case '\r':
+            case '\n':
+                if (game_play(t.g, t.cx, t.cy)) {
+                    t.owner[(uint64_t) t.cx * t.height + t.cy] = (uint8_t) t.player;
+                    if (!fit_view(&t)) {
+                        draw_field(&t, t.cx, t.cy);
+                    } else {
+                        redraw = true;
+                    }
+                    t.player = game_current_player(t.g);
+                    playing = t.player != 0;
+                }
+                break;
+            case 'c':
+            case 'C':
+                game_pass(t.g);
+                t.player = game_current_player(t.g);
+                playing = t.player != 0;
+                break;
+        }
+    }
+
+    restore_terminal();
+    char * board = game_board(t.g);
+    if (board != NULL) { fputs(board, stdout); }
+    free(board);
+    for (uint32_t p = 1; p <= game_players(t.g); p++) {
+        printf("PLAYER %c %llu\n", game_player(t.g, p),
+               (unsigned long long) game_busy_fields(t.g, p));
+    }
+    free(t.owner);
+    game_delete(t.g);
+    return 0;
+}